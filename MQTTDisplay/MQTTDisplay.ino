@@ -5,15 +5,21 @@
 #include "src/mqtt_client.h"
 #include "src/connection.h"
 #include "src/time_service.h"
+#include "src/sntp.h"
 #include "src/schedule.h"
 #include "src/ui.h"
 #include "src/persist.h"
 #include "src/matrix_io.h"
+#include "src/bench.h"
+#include "src/perf.h"
+#include "src/scheduler.h"
+#include "src/settings.h"
+#include "src/sensors.h"
 #include <string.h>
 #include <stdlib.h>
 
 static bool serialForceScreen = false;
-static ScreenMode serial_forced_mode = SCREEN_TEMP;
+static ScreenMode serial_forced_mode = 0;
 
 static void reboot_board() {
 #if defined(ARDUINO_ARCH_RENESAS)
@@ -40,18 +46,32 @@ static void clearForcedScreen(unsigned long now) {
   app.lastUiTickMs = 0;
 }
 
+static void printSensorNames() {
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    if (i) Serial.print("|");
+    Serial.print(SENSORS[i].name);
+  }
+}
+
 static void printSerialHelp() {
   Serial.println("Commands:");
   Serial.println("  reboot");
   Serial.println("  factory reset");
   Serial.println("  status");
-  Serial.println("  show <temp|hum|clock|auto>");
-  Serial.println("  sim temp <value|off>");
-  Serial.println("  sim hum <value|off>");
+  Serial.print("  show <");
+  printSensorNames();
+  Serial.println("|<sensor>_trend|clock|auto>");
+  Serial.print("  sim <");
+  printSensorNames();
+  Serial.println("> <value|off>");
   Serial.println("  sim both <temp> <hum>");
   Serial.println("  sim off");
   Serial.println("  set <show_ms|ui_tick_ms|display_refresh_ms> <value>");
   Serial.println("  get <show_ms|ui_tick_ms|display_refresh_ms|all>");
+  Serial.println("  schedule [set <entries>|add <entry>|clear|default]");
+  Serial.println("    entry: <days> <HH:MM>-<HH:MM> off|dim <pct>|show <screen>[,...]; ...");
+  Serial.println("  bench [iterations]");
+  Serial.println("  perf [reset]");
   Serial.println("  save settings");
   Serial.println("  load settings");
   Serial.println("  help");
@@ -61,28 +81,65 @@ static void printSerialStatus() {
   Serial.print("ForcedScreen=");
   Serial.print(serialForceScreen ? "1" : "0");
   Serial.print(" Mode=");
-  if (serialForceScreen) {
-    if (serial_forced_mode == SCREEN_TEMP) Serial.print("temp");
-    else if (serial_forced_mode == SCREEN_HUM) Serial.print("hum");
-    else Serial.print("clock");
-  } else {
-    Serial.print("auto");
+  if (serialForceScreen) printScreenName(serial_forced_mode);
+  else Serial.print("auto");
+
+  for (uint8_t i = 0; i < SETTINGS_COUNT; i++) {
+    Serial.print(" ");
+    Serial.print(SETTINGS[i].name);
+    Serial.print("=");
+    Serial.print(app.*SETTINGS[i].field);
   }
 
-  Serial.print(" show_ms=");
-  Serial.print(app.showMs);
-  Serial.print(" ui_tick_ms=");
-  Serial.print(app.uiTickMs);
-  Serial.print(" display_refresh_ms=");
-  Serial.print(app.displayRefreshMs);
-
-  Serial.print(" sim_temp=");
-  if (app.simTempEnabled) Serial.print(app.simTemp, 1);
-  else Serial.print("off");
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    Serial.print(" sim_");
+    Serial.print(SENSORS[i].name);
+    Serial.print("=");
+    if (app.sensors[i].simEnabled) printSensorValue(app.sensors[i].simValue);
+    else Serial.print("off");
+  }
 
-  Serial.print(" sim_hum=");
-  if (app.simHumEnabled) Serial.print(app.simHum, 1);
-  else Serial.print("off");
+  Serial.print(" frames_pushed=");
+  Serial.print(app.framesPushed);
+  Serial.print(" frames_skipped=");
+  Serial.print(app.framesSkipped);
+
+  const ConnStats& cs = app.connStats;
+  Serial.print(" reconnects=");
+  Serial.print(cs.reconnects);
+  Serial.print(" reconnect_last_ms=");
+  Serial.print(cs.lastReconnectMs);
+  Serial.print(" reconnect_avg_ms=");
+  Serial.print(cs.reconnects ? cs.totalReconnectMs / cs.reconnects : 0);
+  Serial.print(" reconnect_max_ms=");
+  Serial.print(cs.maxReconnectMs);
+  Serial.print(" connect_attempts=");
+  Serial.print(cs.connectAttempts);
+  Serial.print(" connect_throttled=");
+  Serial.print(cs.connectThrottled);
+  Serial.print(" mqtt_dups=");
+  Serial.print(cs.duplicatesDropped);
+  Serial.print(" mqtt_coalesced=");
+  Serial.print(cs.messagesCoalesced);
+
+  const SntpStats& ns = sntpStats();
+  Serial.print(" ntp_syncs=");
+  Serial.print(ns.syncs);
+  Serial.print(" ntp_timeouts=");
+  Serial.print(ns.timeouts);
+  Serial.print(" ntp_offset_ms=");
+  Serial.print(ns.lastOffsetMs);
+  Serial.print(" ntp_drift_ppm=");
+  Serial.print(ns.driftPpm);
+  Serial.print(" ntp_rtt_ms=");
+  Serial.print(ns.lastRttMs);
+
+  Serial.print(" awake_pct=");
+  Serial.print(schedAwakePercent());
+  Serial.print(" awake_pct_boot=");
+  Serial.print(schedAwakePercentSinceBoot());
+  Serial.print(" matrix_asleep=");
+  Serial.print(app.matrixAsleep ? 1 : 0);
   Serial.println();
 }
 
@@ -109,15 +166,6 @@ static bool parseU32(const char* s, uint32_t& out) {
   return true;
 }
 
-static bool parseFloatInRange(const char* s, float minV, float maxV, float& out) {
-  char* end = nullptr;
-  float v = strtof(s, &end);
-  if (end == s || *end != '\0') return false;
-  if (v < minV || v > maxV) return false;
-  out = v;
-  return true;
-}
-
 static bool applySetCommand(int argc, char* argv[]) {
   if (argc != 3) return false;
 
@@ -127,187 +175,173 @@ static bool applySetCommand(int argc, char* argv[]) {
     return true;
   }
 
-  if (strcmp(argv[1], "show_ms") == 0) {
-    if (value < 500 || value > 120000) {
-      Serial.println("ERR show_ms range 500..120000");
-      return true;
-    }
-    app.showMs = value;
-    app.screenStartMs = millis();
-    Serial.print("OK show_ms=");
-    Serial.println(app.showMs);
+  const SettingDef* def = findSetting(argv[1]);
+  if (!def) {
+    Serial.println("ERR unknown setting");
     return true;
   }
 
-  if (strcmp(argv[1], "ui_tick_ms") == 0) {
-    if (value < 16 || value > 2000) {
-      Serial.println("ERR ui_tick_ms range 16..2000");
-      return true;
-    }
-    app.uiTickMs = value;
-    app.lastUiTickMs = 0;
-    Serial.print("OK ui_tick_ms=");
-    Serial.println(app.uiTickMs);
-    return true;
-  }
-
-  if (strcmp(argv[1], "display_refresh_ms") == 0) {
-    if (value < 4 || value > 1000) {
-      Serial.println("ERR display_refresh_ms range 4..1000");
-      return true;
-    }
-    app.displayRefreshMs = value;
-    app.lastRenderMs = 0;
-    Serial.print("OK display_refresh_ms=");
-    Serial.println(app.displayRefreshMs);
+  if (!applySetting(app, *def, value)) {
+    Serial.print("ERR ");
+    Serial.print(def->name);
+    Serial.print(" range ");
+    Serial.print(def->minValue);
+    Serial.print("..");
+    Serial.println(def->maxValue);
     return true;
   }
-
-  Serial.println("ERR unknown setting");
+  Serial.print("OK ");
+  Serial.print(def->name);
+  Serial.print("=");
+  Serial.println(app.*def->field);
   return true;
 }
 
 static bool applyGetCommand(int argc, char* argv[]) {
   if (argc != 2) return false;
-  if (strcmp(argv[1], "show_ms") == 0) {
-    Serial.print("show_ms=");
-    Serial.println(app.showMs);
-    return true;
-  }
-  if (strcmp(argv[1], "ui_tick_ms") == 0) {
-    Serial.print("ui_tick_ms=");
-    Serial.println(app.uiTickMs);
-    return true;
-  }
-  if (strcmp(argv[1], "display_refresh_ms") == 0) {
-    Serial.print("display_refresh_ms=");
-    Serial.println(app.displayRefreshMs);
-    return true;
-  }
   if (strcmp(argv[1], "all") == 0) {
     printSerialStatus();
     return true;
   }
-  Serial.println("ERR unknown setting");
+  const SettingDef* def = findSetting(argv[1]);
+  if (!def) {
+    Serial.println("ERR unknown setting");
+    return true;
+  }
+  Serial.print(def->name);
+  Serial.print("=");
+  Serial.println(app.*def->field);
   return true;
 }
 
-static void setSimTemp(float value, unsigned long now) {
-  bool changed = !app.simTempEnabled || isnan(app.lastTemp) || fabsf(app.lastTemp - value) >= PERSIST_DELTA;
-  app.simTempEnabled = true;
-  app.simTemp = value;
-  app.lastTemp = value;
-  app.lastTempUpdateMs = now;
+static void setSimSensor(SensorId id, int32_t value, unsigned long now) {
+  SensorState& st = app.sensors[id];
+  bool wasSim = st.simEnabled;
+  st.simEnabled = true;
+  st.simValue = value;
+  sensorStore(app, id, value, now);
+  if (!wasSim) st.updatedSincePersist = true;
   app.simLastRefreshMs = now;
-  if (changed) app.tempUpdatedSincePersist = true;
 }
 
-static void setSimHum(float value, unsigned long now) {
-  bool changed = !app.simHumEnabled || isnan(app.lastHum) || fabsf(app.lastHum - value) >= PERSIST_DELTA;
-  app.simHumEnabled = true;
-  app.simHum = value;
-  app.lastHum = value;
-  app.lastHumUpdateMs = now;
-  app.simLastRefreshMs = now;
-  if (changed) app.humUpdatedSincePersist = true;
+static bool parseSimValue(SensorId id, const char* arg, int32_t& value) {
+  const char* end = parseSensorValue(arg, value);
+  if (end && *end == '\0' && sensorInRange(id, value)) return true;
+  Serial.print("ERR ");
+  Serial.print(SENSORS[id].name);
+  Serial.println(" out of range");
+  return false;
 }
 
 static bool applySimCommand(int argc, char* argv[], unsigned long now) {
   if (argc == 2 && strcmp(argv[1], "off") == 0) {
-    app.simTempEnabled = false;
-    app.simHumEnabled = false;
+    for (SensorState& st : app.sensors) st.simEnabled = false;
     Serial.println("OK simulation off");
     return true;
   }
 
-  if (argc == 3 && strcmp(argv[1], "temp") == 0) {
-    if (strcmp(argv[2], "off") == 0) {
-      app.simTempEnabled = false;
-      Serial.println("OK sim temp off");
-      return true;
-    }
-    float value = 0.0f;
-    if (!parseFloatInRange(argv[2], TEMP_MIN_C, TEMP_MAX_C, value)) {
-      Serial.println("ERR temp out of range");
-      return true;
-    }
-    setSimTemp(value, now);
-    Serial.print("OK sim temp=");
-    Serial.println(app.simTemp, 1);
+  if (argc == 4 && strcmp(argv[1], "both") == 0) {
+    int32_t t = 0;
+    int32_t h = 0;
+    if (!parseSimValue(SENSOR_TEMP, argv[2], t)) return true;
+    if (!parseSimValue(SENSOR_HUM, argv[3], h)) return true;
+    setSimSensor(SENSOR_TEMP, t, now);
+    setSimSensor(SENSOR_HUM, h, now);
+    Serial.print("OK sim both temp=");
+    printSensorValue(t);
+    Serial.print(" hum=");
+    printSensorValue(h);
+    Serial.println();
     return true;
   }
 
-  if (argc == 3 && strcmp(argv[1], "hum") == 0) {
-    if (strcmp(argv[2], "off") == 0) {
-      app.simHumEnabled = false;
-      Serial.println("OK sim hum off");
-      return true;
-    }
-    float value = 0.0f;
-    if (!parseFloatInRange(argv[2], HUM_MIN, HUM_MAX, value)) {
-      Serial.println("ERR hum out of range");
-      return true;
-    }
-    setSimHum(value, now);
-    Serial.print("OK sim hum=");
-    Serial.println(app.simHum, 1);
+  if (argc != 3) return false;
+  SensorId id = findSensor(argv[1]);
+  if (id == SENSOR_COUNT) return false;
+
+  if (strcmp(argv[2], "off") == 0) {
+    app.sensors[id].simEnabled = false;
+    Serial.print("OK sim ");
+    Serial.print(SENSORS[id].name);
+    Serial.println(" off");
     return true;
   }
+  int32_t value = 0;
+  if (!parseSimValue(id, argv[2], value)) return true;
+  setSimSensor(id, value, now);
+  Serial.print("OK sim ");
+  Serial.print(SENSORS[id].name);
+  Serial.print("=");
+  printSensorValue(value);
+  Serial.println();
+  return true;
+}
 
-  if (argc == 4 && strcmp(argv[1], "both") == 0) {
-    float t = 0.0f;
-    float h = 0.0f;
-    if (!parseFloatInRange(argv[2], TEMP_MIN_C, TEMP_MAX_C, t)) {
-      Serial.println("ERR temp out of range");
+static bool applyScheduleCommand(const char* args) {
+  while (*args == ' ') args++;
+  if (*args == '\0') {
+    printSchedule(app.schedule);
+    return true;
+  }
+
+  const char* rest = strchr(args, ' ');
+  size_t verbLen = rest ? (size_t)(rest - args) : strlen(args);
+  rest = rest ? rest + 1 : "";
+
+  if (verbLen == 5 && strncmp(args, "clear", 5) == 0 && *rest == '\0') {
+    applyScheduleText(app, "");
+  } else if (verbLen == 7 && strncmp(args, "default", 7) == 0 && *rest == '\0') {
+    applyScheduleText(app, SCHEDULE_DEFAULT);
+  } else if (verbLen == 3 && strncmp(args, "set", 3) == 0) {
+    if (!applyScheduleText(app, rest)) {
+      Serial.println("ERR schedule syntax");
       return true;
     }
-    if (!parseFloatInRange(argv[3], HUM_MIN, HUM_MAX, h)) {
-      Serial.println("ERR hum out of range");
+  } else if (verbLen == 3 && strncmp(args, "add", 3) == 0) {
+    Schedule entry;
+    if (!parseSchedule(rest, entry) || app.schedule.count + entry.count > SCHEDULE_MAX_INTERVALS) {
+      Serial.println("ERR schedule syntax or table full");
       return true;
     }
-    setSimTemp(t, now);
-    setSimHum(h, now);
-    Serial.print("OK sim both temp=");
-    Serial.print(app.simTemp, 1);
-    Serial.print(" hum=");
-    Serial.println(app.simHum, 1);
-    return true;
+    Schedule next = app.schedule;
+    memcpy(next.intervals + next.count, entry.intervals, entry.count * sizeof(ScheduleInterval));
+    next.count = (uint8_t)(next.count + entry.count);
+    app.schedule = next;
+    saveSchedule(app);
+    scheduleChanged(app);
+  } else {
+    return false;
   }
-
-  return false;
+  Serial.println("OK schedule");
+  printSchedule(app.schedule);
+  return true;
 }
 
 static void applySensorSimulation(unsigned long now) {
-  if (!app.simTempEnabled && !app.simHumEnabled) return;
-  if (now - app.simLastRefreshMs < 1000) return;
-  app.simLastRefreshMs = now;
-  if (app.simTempEnabled) {
-    app.lastTemp = app.simTemp;
-    app.lastTempUpdateMs = now;
+  bool anySim = false;
+  for (const SensorState& st : app.sensors) anySim |= st.simEnabled;
+  if (!anySim) return;
+  if (now - app.simLastRefreshMs < 1000) {
+    schedAt(TASK_SIM, app.simLastRefreshMs + 1000);
+    return;
   }
-  if (app.simHumEnabled) {
-    app.lastHum = app.simHum;
-    app.lastHumUpdateMs = now;
+  app.simLastRefreshMs = now;
+  schedAt(TASK_SIM, now + 1000);
+  for (SensorState& st : app.sensors) {
+    if (!st.simEnabled) continue;
+    st.value = st.simValue;
+    st.updateMs = now;
   }
 }
 
 static void applyFactoryReset(unsigned long now) {
   factoryResetPersisted();
 
-  app.showMs = SHOW_MS;
-  app.uiTickMs = UI_TICK_MS;
-  app.displayRefreshMs = DISPLAY_REFRESH_MS;
-  app.lastTemp = NAN;
-  app.lastHum = NAN;
-  app.lastTempUpdateMs = 0;
-  app.lastHumUpdateMs = 0;
-  app.tempUpdatedSincePersist = false;
-  app.humUpdatedSincePersist = false;
+  resetSettings(app);
+  resetSensors(app);
+  scheduleReset(app.schedule);
+  scheduleChanged(app);
   app.lastPersistMs = 0;
-  app.simTempEnabled = false;
-  app.simHumEnabled = false;
-  app.simTemp = NAN;
-  app.simHum = NAN;
   app.simLastRefreshMs = 0;
 
   clearForcedScreen(now);
@@ -317,7 +351,7 @@ static void applyFactoryReset(unsigned long now) {
 }
 
 static void handleSerialCommands(unsigned long now) {
-  static char cmd[96];
+  static char cmd[SCHEDULE_TEXT_MAX];
   static uint8_t len = 0;
 
   while (Serial.available() > 0) {
@@ -327,6 +361,12 @@ static void handleSerialCommands(unsigned long now) {
     }
     if (c == '\n') {
       cmd[len] = '\0';
+      // Schedule entries contain spaces; they take the rest of the line.
+      if (strncmp(cmd, "schedule", 8) == 0 && (cmd[8] == '\0' || cmd[8] == ' ')) {
+        if (!applyScheduleCommand(cmd + 8)) Serial.println("ERR usage: schedule [set <entries>|add <entry>|clear|default]");
+        len = 0;
+        continue;
+      }
       char* argv[6] = {nullptr};
       int argc = splitArgs(cmd, argv, 6);
       if (argc == 0) {
@@ -336,26 +376,26 @@ static void handleSerialCommands(unsigned long now) {
 
       if (strcmp(argv[0], "reboot") == 0 && argc == 1) {
         Serial.println("Rebooting...");
+        persistFlush();
         delay(20);
         reboot_board();
       } else if (strcmp(argv[0], "factory") == 0 && argc == 2 && strcmp(argv[1], "reset") == 0) {
         applyFactoryReset(now);
         Serial.println("OK factory reset");
       } else if (strcmp(argv[0], "show") == 0 && argc == 2) {
-        if (strcmp(argv[1], "temp") == 0) {
-          forceScreen(SCREEN_TEMP, now);
-          Serial.println("OK show temp");
-        } else if (strcmp(argv[1], "hum") == 0) {
-          forceScreen(SCREEN_HUM, now);
-          Serial.println("OK show hum");
-        } else if (strcmp(argv[1], "clock") == 0) {
-          forceScreen(SCREEN_CLOCK, now);
-          Serial.println("OK show clock");
+        ScreenMode mode = 0;
+        if (parseScreenName(argv[1], mode)) {
+          forceScreen(mode, now);
+          Serial.print("OK show ");
+          printScreenName(mode);
+          Serial.println();
         } else if (strcmp(argv[1], "auto") == 0) {
           clearForcedScreen(now);
           Serial.println("OK show auto");
         } else {
-          Serial.println("ERR show expects temp|hum|clock|auto");
+          Serial.print("ERR show expects ");
+          printSensorNames();
+          Serial.println("|<sensor>_trend|clock|auto");
         }
       } else if (strcmp(argv[0], "auto") == 0 && argc == 1) {
         clearForcedScreen(now);
@@ -365,7 +405,20 @@ static void handleSerialCommands(unsigned long now) {
       } else if (strcmp(argv[0], "get") == 0) {
         if (!applyGetCommand(argc, argv)) Serial.println("ERR usage: get <key|all>");
       } else if (strcmp(argv[0], "sim") == 0) {
-        if (!applySimCommand(argc, argv, now)) Serial.println("ERR usage: sim temp|hum|both|off ...");
+        if (!applySimCommand(argc, argv, now)) Serial.println("ERR usage: sim <sensor>|both|off ...");
+      } else if (strcmp(argv[0], "bench") == 0 && argc <= 2) {
+        uint32_t iterations = 200;
+        if (argc == 2 && (!parseU32(argv[1], iterations) || iterations < 1 || iterations > 5000)) {
+          Serial.println("ERR bench iterations range 1..5000");
+        } else {
+          runRenderBench(app, iterations);
+          Serial.println("OK bench");
+        }
+      } else if (strcmp(argv[0], "perf") == 0 && argc == 1) {
+        perfPrint();
+      } else if (strcmp(argv[0], "perf") == 0 && argc == 2 && strcmp(argv[1], "reset") == 0) {
+        perfReset();
+        Serial.println("OK perf reset");
       } else if (strcmp(argv[0], "save") == 0 && argc == 2 && strcmp(argv[1], "settings") == 0) {
         saveRuntimeSettings(app);
         Serial.println("OK settings saved");
@@ -408,6 +461,7 @@ void setup() {
   Serial.println("https://elNino0916.de");
   Serial.println("=====================");
   Serial.println("Setup start");
+  perfReset();
 
 #if HAS_WDT
   WDT.begin(WDT_TIMEOUT_MS);
@@ -426,16 +480,17 @@ void setup() {
   // Quick visual self-test: checkerboard for 300ms
   for (int y = 0; y < 8; y++) {
     for (int x = 0; x < 12; x++) {
-      app.frame[y][x] = ((x + y) % 2) ? 1 : 0;
+      graySetPixel(app.frame, x, y, ((x + y) % 2) != 0 ? GRAY_MAX : 0);
     }
   }
-  matrixRenderBitmap(app, app.frame);
+  matrixRenderGray(app, app.frame);
   delay(300);
 #endif
 
   initAppState(app);
   loadPersisted(app);
   loadRuntimeSettings(app);
+  if (!loadSchedule(app)) scheduleReset(app.schedule);
   initTimeService(app);
 
   drawWifiBarsAnim(app, 0);
@@ -446,12 +501,45 @@ void setup() {
   Serial.println("Setup done");
 }
 
+// Night pass: the matrix is either stopped or shows the minimal clock,
+// redrawn only when it flips between hours and minutes. Between MQTT polls
+// and the minute LED blink the MCU sleeps.
+static void nightTick(unsigned long now) {
+  unsigned long loopStartUs = micros();
+  unsigned long markUs = loopStartUs;
+
+  mqttPoll(app, now);
+  perfLap(PERF_MQTT_POLL, markUs);
+
+  if (NIGHT_SHOW_CLOCK) {
+    unsigned long flipMs = (now / CLOCK_TOGGLE_MS) * CLOCK_TOGGLE_MS;
+    if (app.lastUiTickMs == 0 || (long)(app.lastUiTickMs - flipMs) < 0) {
+      app.lastUiTickMs = now;
+      drawClockMinimal(app, now, now - app.screenStartMs);
+    }
+    schedAt(TASK_UI, flipMs + CLOCK_TOGGLE_MS);
+  } else {
+    matrixSleep(app);
+  }
+  perfLap(PERF_UI, markUs);
+
+  nightLedMinuteBlink(app, now);
+  maybePersist(app, now);
+  perfLap(PERF_PERSIST, markUs);
+
+  perfRecord(PERF_LOOP, micros() - loopStartUs);
+  schedIdle(now, NIGHT_MAX_SLEEP_MS);
+}
+
 void loop() {
   unsigned long now = millis();
   static unsigned long lastHeartbeatMs = 0;
   static unsigned long uiDraws = 0;
   static bool wasNightMode = false;
+  unsigned long loopStartUs = micros();
+  unsigned long markUs = loopStartUs;
 
+  schedBeginPass();
   handleSerialCommands(now);
 
 #if HAS_WDT
@@ -469,26 +557,9 @@ void loop() {
       reinitDone = true;
       bool ok = matrixInit(app);
     }
-    static uint8_t frameA[8][12] = {
-      {0,0,0,0,0,1,1,0,0,0,0,0},
-      {0,0,0,0,0,1,1,0,0,0,0,0},
-      {0,0,0,0,0,1,1,0,0,0,0,0},
-      {0,0,0,0,0,1,1,0,0,0,0,0},
-      {0,0,0,0,0,1,1,0,0,0,0,0},
-      {0,0,0,0,0,0,0,0,0,0,0,0},
-      {0,0,0,0,0,1,1,0,0,0,0,0},
-      {0,0,0,0,0,1,1,0,0,0,0,0}
-    };
-    static uint8_t frameB[8][12] = {
-            {0,0,0,0,0,0,0,0,0,0,0,0},
-{1,1,0,0,1,1,0,0,1,1,1,0},
-{1,0,1,0,1,0,1,0,1,0,0,0},
-{1,0,1,0,1,1,0,0,1,0,0,0},
-{1,0,1,0,1,0,1,0,1,1,1,0},
-{1,0,1,0,1,0,1,0,1,0,1,0},
-{1,1,0,0,1,1,0,0,1,1,1,0},
-      {0,0,0,0,0,0,0,0,0,0,0,0},
-    };
+    // "!" and "DBG" as packed frames (see src/frame.h for the bit layout).
+    static const Frame frameA = {{0x06006006UL, 0x00600600UL, 0x00060060UL}};
+    static const Frame frameB = {{0x000CCEAAUL, 0x8AC8AAEAUL, 0xAACCE000UL}};
     if (dbg) {
       matrixRenderBitmap(app, frameA);
       Serial.println("!!! DEBUG MODE ENABLED, RE-FLASH FIRMWARE !!!");
@@ -516,8 +587,8 @@ void loop() {
     Serial.print(timeIsValid(app) ? "1" : "0");
     if (timeIsValid(app)) {
       Serial.print(" Berlin=");
-      int hh = berlinHour();
-      int mm = berlinMinute();
+      int hh = berlinNow().hour;
+      int mm = berlinNow().minute;
       if (hh < 10) Serial.print("0");
       Serial.print(hh);
       Serial.print(":");
@@ -531,74 +602,91 @@ void loop() {
     Serial.print(" Draws=");
     Serial.println(uiDraws);
   }
+  schedAt(TASK_HEARTBEAT, lastHeartbeatMs + 60000);
 #endif
-
+  perfLap(PERF_SERIAL, markUs);
 
   connectionTick(app, now);
-  timeServiceTick(app);
+  perfLap(PERF_CONNECTION, markUs);
+  timeServiceTick(app, now);
+  perfLap(PERF_TIME, markUs);
   applySensorSimulation(now);
+  perfLap(PERF_SIM, markUs);
 
-  if (app.connState == CONN_OK) {
-    applyDisplayOffIfNeeded(app, shouldDisplayBeOffNow(app));
-  } else {
-    applyDisplayOffIfNeeded(app, false);
-  }
-
-  if (!app.displayOffForSchedule) {
-    nightLedMinuteBlink(app, now);
-  }
+  scheduleTick(app, app.connState == CONN_OK, now);
 
   if (app.displayOffForSchedule != wasNightMode) {
     wasNightMode = app.displayOffForSchedule;
+    if (wasNightMode) {
+      app.wipe.active = false;
+    } else {
+      matrixWake(app);
+      app.ledPulseUntilMs = 0;
+      digitalWrite(LED_BUILTIN, LOW);
+    }
     app.screenStartMs = now;
     app.lastUiTickMs = 0;
   }
+  perfLap(PERF_SCHEDULE, markUs);
+
+  if (app.connState == CONN_OK && app.displayOffForSchedule) {
+    nightTick(now);
+    return;
+  }
 
   if (app.connState == CONN_OK && app.wipe.active) {
-    app.mqttClient.poll();
+    mqttPoll(app, now);
+    perfLap(PERF_MQTT_POLL, markUs);
     tickWipe(app, now);
+    matrixRefreshTick(app, now);
+    perfLap(PERF_WIPE, markUs);
     maybePersist(app, now);
-    delay(1);
+    perfLap(PERF_PERSIST, markUs);
+    perfRecord(PERF_LOOP, micros() - loopStartUs);
+    schedIdle(now, LOOP_MAX_SLEEP_MS);
     return;
   }
 
   if (app.connState == CONN_OK) {
-    app.mqttClient.poll();
+    mqttPoll(app, now);
+    perfLap(PERF_MQTT_POLL, markUs);
 
     unsigned long elapsed = now - app.screenStartMs;
 
     if (now - app.lastUiTickMs >= app.uiTickMs) {
       app.lastUiTickMs = now;
 
-      if (app.displayOffForSchedule) {
-        drawClockMinimal(app, now, elapsed);
-      } else {
-        ScreenMode drawMode = serialForceScreen ? serial_forced_mode : app.mode;
-        if (drawMode == SCREEN_TEMP)      drawTempScreen(app, now, elapsed);
-        else if (drawMode == SCREEN_HUM)  drawHumScreen(app, now, elapsed);
-        else                              drawClockScreen(app, now, elapsed);
-      }
+      drawScreen(app, serialForceScreen ? serial_forced_mode : app.mode, now, elapsed);
 
       uiDraws++;
     }
+    schedAt(TASK_UI, app.lastUiTickMs + app.uiTickMs);
 
-    if (!serialForceScreen && !app.displayOffForSchedule && elapsed >= app.showMs) {
-      if (app.mode == SCREEN_TEMP) {
-        startWipe(app, now, drawTempScreen, drawHumScreen, SCREEN_HUM);
-      } else if (app.mode == SCREEN_HUM) {
-        startWipe(app, now, drawHumScreen, drawClockScreen, SCREEN_CLOCK);
-      } else {
-        startWipe(app, now, drawClockScreen, drawTempScreen, SCREEN_TEMP);
-      }
+    if (!serialForceScreen && elapsed >= app.showMs) {
+      startWipe(app, now, app.mode, nextScreen(app.mode, app.screenMask));
     }
-
-    maybePersist(app, now);
+    if (!serialForceScreen && !app.wipe.active) {
+      schedAt(TASK_UI, app.screenStartMs + app.showMs);
+    }
+    perfLap(PERF_UI, markUs);
   }
 
-  if (now - app.lastRenderMs >= app.displayRefreshMs) {
-    app.lastRenderMs = now;
-    matrixRenderBitmap(app, app.frame);
+  maybePersist(app, now);
+  perfLap(PERF_PERSIST, markUs);
+
+  // Screens push their own frames; this only catches a frame (or brightness)
+  // left unshown, at most once per displayRefreshMs.
+  if (matrixNeedsRender(app, app.frame)) {
+    if (now - app.lastRenderMs >= app.displayRefreshMs) {
+      app.lastRenderMs = now;
+      matrixRenderGray(app, app.frame);
+    } else {
+      schedAt(TASK_RENDER, app.lastRenderMs + app.displayRefreshMs);
+    }
   }
+  matrixRefreshTick(app, now);
+  perfLap(PERF_RENDER, markUs);
 
-  delay(1);
+  perfRecord(PERF_LOOP, micros() - loopStartUs);
+  schedIdle(now, LOOP_MAX_SLEEP_MS);
 }
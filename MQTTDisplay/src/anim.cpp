@@ -0,0 +1,106 @@
+#include "anim.h"
+
+template <uint8_t N>
+struct FrameTable {
+  Frame frames[N];
+};
+
+// Two nodes with a packet bouncing between them, trailing a tail and a
+// flickering nose; the nodes pulse when the packet arrives.
+static constexpr Frame buildMqttFrame(unsigned long phase) {
+  Frame f{};
+  const int xmin = 2;
+  const int xmax = 9;
+  const int span = xmax - xmin;
+
+  int p = (int)(phase % (span * 2));
+  bool forward = p <= span;
+  int x = forward ? xmin + p : xmax - (p - span);
+
+  int y = 3 + (int)((phase / 4) & 0x1);
+  frameSetPixel(f, x, y, true);
+  frameSetPixel(f, x, y + 1, true);
+
+  if (forward) {
+    if (x - 2 >= xmin) frameSetPixel(f, x - 2, y + 1, true);
+    if ((phase & 0x1) == 0 && x + 1 <= xmax) frameSetPixel(f, x + 1, y, true);
+  } else {
+    if (x + 2 <= xmax) frameSetPixel(f, x + 2, y + 1, true);
+    if ((phase & 0x1) == 0 && x - 1 >= xmin) frameSetPixel(f, x - 1, y, true);
+  }
+
+  frameSetPixel(f, 0, 4, true);
+  frameSetPixel(f, 0, 5, true);
+  frameSetPixel(f, 11, 2, true);
+  frameSetPixel(f, 11, 3, true);
+  frameSetPixel(f, 11, 4, true);
+  if (x == xmin && (phase & 0x3) == 0) frameSetPixel(f, 1, 4, true);
+  if (x == xmax && (phase & 0x3) == 0) frameSetPixel(f, 10, 3, true);
+  return f;
+}
+
+// Four bars rising and falling in a wave, with a sparkle on the tallest bar
+// at the peak.
+static constexpr Frame buildWifiFrame(int step) {
+  Frame f{};
+  frameSetPixel(f, 0, 6, true);
+
+  const int xs[4] = {2, 4, 6, 8};
+  const int h[4] = {1, 2, 3, 4};
+  const uint8_t wave[24] = {
+    0,1,2,3,4,3,2,1,0,0,1,2,
+    3,4,3,2,1,0,0,1,2,3,2,1
+  };
+
+  for (int b = 0; b < 4; b++) {
+    int lit = wave[(step + b * 4) % 24];
+    if (lit > h[b]) lit = h[b];
+    for (int yy = 0; yy < lit; yy++) frameSetPixel(f, xs[b], 6 - yy, true);
+  }
+  if (wave[(step + 12) % 24] >= 4) frameSetPixel(f, 8, 2, true);
+  return f;
+}
+
+static constexpr Frame buildBigXFrame(bool pulse) {
+  Frame f{};
+  for (int i = 0; i < 8; i++) {
+    int x1 = (i * 22 + 7) / 14;  // round(i * 11 / 7)
+    frameSetPixel(f, x1, i, true);
+    frameSetPixel(f, 11 - x1, i, true);
+  }
+  if (pulse) {
+    frameSetPixel(f, 0, 0, true);
+    frameSetPixel(f, 11, 0, true);
+    frameSetPixel(f, 0, 7, true);
+    frameSetPixel(f, 11, 7, true);
+  }
+  return f;
+}
+
+static constexpr FrameTable<MQTT_ANIM_FRAMES> buildMqttTable() {
+  FrameTable<MQTT_ANIM_FRAMES> t{};
+  for (uint8_t i = 0; i < MQTT_ANIM_FRAMES; i++) t.frames[i] = buildMqttFrame(i);
+  return t;
+}
+
+static constexpr FrameTable<WIFI_ANIM_FRAMES> buildWifiTable() {
+  FrameTable<WIFI_ANIM_FRAMES> t{};
+  for (uint8_t i = 0; i < WIFI_ANIM_FRAMES; i++) t.frames[i] = buildWifiFrame(i);
+  return t;
+}
+
+static constexpr FrameTable<MQTT_ANIM_FRAMES> MQTT_ANIM = buildMqttTable();
+static constexpr FrameTable<WIFI_ANIM_FRAMES> WIFI_ANIM = buildWifiTable();
+static constexpr FrameTable<BIG_X_FRAMES> BIG_X = {{buildBigXFrame(true), buildBigXFrame(false)}};
+
+const Frame& mqttAnimFrame(unsigned long phase) {
+  return MQTT_ANIM.frames[phase % MQTT_ANIM_FRAMES];
+}
+
+const Frame& wifiAnimFrame(int step) {
+  return WIFI_ANIM.frames[(unsigned)step % WIFI_ANIM_FRAMES];
+}
+
+const Frame& bigXFrame(unsigned long now) {
+  return BIG_X.frames[(now / BIG_X_PULSE_MS) % BIG_X_FRAMES];
+}
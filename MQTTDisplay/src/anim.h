@@ -0,0 +1,14 @@
+#pragma once
+
+#include "frame.h"
+
+// Connection animations, generated at compile time into flash. Playback is
+// one table lookup per tick.
+const uint8_t MQTT_ANIM_FRAMES = 56;   // packet sweep (14) x bounce (8)
+const uint8_t WIFI_ANIM_FRAMES = 5;
+const uint8_t BIG_X_FRAMES = 2;        // corner pulse on / off
+const unsigned long BIG_X_PULSE_MS = 900;
+
+const Frame& mqttAnimFrame(unsigned long phase);
+const Frame& wifiAnimFrame(int step);
+const Frame& bigXFrame(unsigned long now);
@@ -1,5 +1,6 @@
 #include "app_state.h"
 #include "matrix_io.h"
+#include "scheduler.h"
 
 AppState app;
 
@@ -12,54 +13,164 @@ void initAppState(AppState& s) {
   s.mqttBackoffMs = 0;
   s.wifiBackoffUntilMs = 0;
   s.wifiBackoffMs = 0;
+  s.mqttOkSinceMs = 0;
+  s.fastReconnect = false;
+  s.mqttFirstTryDelayMs = 0;
+  s.wifiLeaseValid = false;
+  s.connectTokens = MQTT_CONNECT_BURST;
+  s.connectTokenMs = 0;
+  s.connStats = ConnStats();
 
   s.screenStartMs = 0;
   s.lastUiTickMs = 0;
   s.lastRenderMs = 0;
-  s.mode = SCREEN_TEMP;
+  s.mode = 0;
 
   s.wifiAnimStep = 0;
   s.mqttPhase = 0;
 
   s.timeValid = false;
 
-  s.lastTemp = NAN;
-  s.lastHum = NAN;
-  s.lastTempUpdateMs = 0;
-  s.lastHumUpdateMs = 0;
-  s.tempUpdatedSincePersist = false;
-  s.humUpdatedSincePersist = false;
+  resetSensors(s);
   s.lastPersistMs = 0;
   s.showMs = SHOW_MS;
   s.uiTickMs = UI_TICK_MS;
   s.displayRefreshMs = DISPLAY_REFRESH_MS;
-  s.simTempEnabled = false;
-  s.simHumEnabled = false;
-  s.simTemp = NAN;
-  s.simHum = NAN;
   s.simLastRefreshMs = 0;
 
+  s.scheduleActive = -1;
+  s.scheduleEvalS = 0;
+  s.scheduleNextS = 0;
+  s.brightness = 100;
+  s.screenMask = 0;
   s.displayOffForSchedule = false;
   s.lastBlinkMinute = -1;
   s.ledPulseUntilMs = 0;
 
+  grayClear(s.frame);
+  s.bam = MatrixBam();
+  s.lastPushedValid = false;
+  s.matrixAsleep = false;
+  s.framesPushed = 0;
+  s.framesSkipped = 0;
   s.wipe.active = false;
 }
 
-void matrixRenderBitmap(AppState& s, uint8_t bitmap[8][12]) {
-  s.matrix.renderBitmap(bitmap, 8, 12);
+void matrixRenderBitmap(AppState& s, const Frame& f) {
+  // Identical frames never reach the matrix; comparing 3 words is cheaper than hashing.
+  if (s.lastPushedValid && frameEqual(s.lastPushedFrame, f)) {
+    s.framesSkipped++;
+    return;
+  }
+  s.matrix.loadFrame(f.w);
+  frameCopy(s.lastPushedFrame, f);
+  s.lastPushedValid = true;
+  s.framesPushed++;
 }
 
-void matrixRenderBitmapConst(AppState& s, const uint8_t bitmap[8][12]) {
-  static uint8_t tmp[8][12];
-  for (int r = 0; r < 8; r++) {
-    for (int c = 0; c < 12; c++) {
-      tmp[r][c] = bitmap[r][c];
+// Brightness scales each lit pixel's level (rounded, at least 1) rather than
+// adding blank time, so the cycle stays GRAY_MAX scans long at any setting.
+static void bamBuildSlots(MatrixBam& b, GrayFrame& scaled) {
+  grayCopy(scaled, b.source);
+  if (b.brightness < 100) {
+    for (int y = 0; y < FRAME_H; y++) {
+      for (int x = 0; x < FRAME_W; x++) {
+        uint8_t level = grayGetPixel(b.source, x, y);
+        if (level == 0) continue;
+        uint8_t dimmed = (uint8_t)((level * b.brightness + 50) / 100);
+        graySetPixel(scaled, x, y, dimmed ? dimmed : 1);
+      }
     }
   }
-  s.matrix.renderBitmap(tmp, 8, 12);
+  for (uint8_t p = 0; p < GRAY_BITS; p++) {
+    frameCopy(b.slot[p], scaled.plane[p]);
+    b.slotMs[p] = (uint8_t)((1u << p) * MATRIX_SCAN_MS);
+  }
+}
+
+// 0 means off, which night mode handles by stopping the matrix; the
+// optional night clock is shown at full brightness.
+static uint8_t matrixBrightness(const AppState& s) {
+  return (s.brightness == 0 || s.brightness > 100) ? 100 : s.brightness;
+}
+
+bool matrixNeedsRender(const AppState& s, const GrayFrame& g) {
+  const MatrixBam& b = s.bam;
+  return !(b.sourceValid && b.brightness == matrixBrightness(s) && grayEqual(b.source, g));
+}
+
+void matrixRenderGray(AppState& s, const GrayFrame& g) {
+  uint8_t pct = matrixBrightness(s);
+  MatrixBam& b = s.bam;
+  if (!matrixNeedsRender(s, g)) {
+    s.framesSkipped++;
+    return;
+  }
+  grayCopy(b.source, g);
+  b.brightness = pct;
+  b.sourceValid = true;
+
+  GrayFrame scaled;
+  bamBuildSlots(b, scaled);
+  if (grayIsBinary(scaled)) {
+    b.active = false;
+    matrixRenderBitmap(s, scaled.plane[0]);
+    return;
+  }
+
+  if (!b.active) {
+    b.active = true;
+    b.cur = 0;
+    b.nextMs = millis() + b.slotMs[b.cur];
+  }
+  // Keep the cycle phase; only the content of the current slot changes.
+  matrixRenderBitmap(s, b.slot[b.cur]);
+  schedAt(TASK_REFRESH, b.nextMs);
+}
+
+void matrixRefreshTick(AppState& s, unsigned long now) {
+  MatrixBam& b = s.bam;
+  if (!b.active) return;
+  if ((long)(now - b.nextMs) < 0) {
+    schedAt(TASK_REFRESH, b.nextMs);
+    return;
+  }
+  b.cur = (uint8_t)((b.cur + 1) % BAM_SLOTS);
+  matrixRenderBitmap(s, b.slot[b.cur]);
+
+  // Stay on the slot grid so a late pass shortens the next slot instead of
+  // shifting the cycle; resync only if a whole slot was missed.
+  b.nextMs += b.slotMs[b.cur];
+  if ((long)(now - b.nextMs) >= 0) b.nextMs = now + b.slotMs[b.cur];
+  schedAt(TASK_REFRESH, b.nextMs);
+}
+
+void matrixInvalidate(AppState& s) {
+  s.lastPushedValid = false;
+  s.bam.sourceValid = false;
+  s.matrixAsleep = false;
 }
 
 bool matrixInit(AppState& s) {
+  matrixInvalidate(s);
+  s.matrixAsleep = false;
   return s.matrix.begin();
 }
+
+void matrixSleep(AppState& s) {
+  if (s.matrixAsleep) return;
+  s.bam.active = false;
+  s.bam.sourceValid = false;
+  Frame blank;
+  frameClear(blank);
+  matrixRenderBitmap(s, blank);
+  // Let the scan pass over the blank frame once so no LED is left driven.
+  delay(2);
+  s.matrix.end();
+  s.matrixAsleep = true;
+}
+
+bool matrixWake(AppState& s) {
+  if (!s.matrixAsleep) return true;
+  return matrixInit(s);
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "platform.h"
 #include "../config.h"
+#include "frame.h"
+#include "sensors.h"
+#include "history.h"
 
 enum ConnState : uint8_t {
   CONN_WIFI_WARMUP,
@@ -14,21 +18,78 @@ enum ConnState : uint8_t {
   CONN_OK
 };
 
-enum ScreenMode { SCREEN_TEMP, SCREEN_HUM, SCREEN_CLOCK };
+// Screens 0..SENSOR_COUNT-1 show the sensor with that id, SCREEN_TREND + id
+// its history (sensors that keep one), then the clock.
+typedef uint8_t ScreenMode;
+const ScreenMode SCREEN_TREND = SENSOR_COUNT;
+const ScreenMode SCREEN_CLOCK = 2 * SENSOR_COUNT;
+const ScreenMode SCREEN_COUNT = SCREEN_CLOCK + 1;
+// One bit per ScreenMode.
+typedef uint32_t ScreenMask;
+static_assert(SCREEN_COUNT <= 32, "ScreenMask holds one bit per screen");
 
 struct WipeAnim {
   bool active = false;
-  uint8_t from[8][12];
-  uint8_t to[8][12];
-  uint8_t out[8][12];
+  GrayFrame from;
+  GrayFrame to;
+  GrayFrame out;
   uint8_t step = 0;
   unsigned long nextStepMs = 0;
   unsigned long stepIntervalMs = 0;
-  ScreenMode nextMode = SCREEN_TEMP;
+  ScreenMode nextMode = 0;
 
   static const uint8_t order[12];
 };
 
+// Bit-angle modulation of the current GrayFrame, after brightness scaled
+// its levels: plane b is loaded for 2^b matrix scans. Only runs while some
+// pixel is between off and GRAY_MAX; otherwise one frame is loaded.
+const uint8_t BAM_SLOTS = GRAY_BITS;
+
+struct MatrixBam {
+  bool active = false;
+  GrayFrame source;
+  uint8_t brightness = 100;
+  bool sourceValid = false;
+  Frame slot[BAM_SLOTS];
+  uint8_t slotMs[BAM_SLOTS];
+  uint8_t cur = 0;
+  unsigned long nextMs = 0;
+};
+
+// Reconnect timing, reported by the serial 'status' command.
+struct ConnStats {
+  bool outage = false;                  // a session was lost and not yet restored
+  unsigned long outageStartMs = 0;
+  unsigned long reconnects = 0;
+  unsigned long lastReconnectMs = 0;
+  unsigned long maxReconnectMs = 0;
+  unsigned long totalReconnectMs = 0;
+  unsigned long connectAttempts = 0;
+  unsigned long connectThrottled = 0;   // attempts deferred by the token bucket
+  unsigned long duplicatesDropped = 0;  // QoS1 redeliveries already applied
+  unsigned long messagesCoalesced = 0;  // readings replaced by a newer one in the same poll pass
+};
+
+// Weekly display schedule; times are minutes since Sunday 00:00 local.
+// One interval per schedule entry; its days are a mask, not separate copies.
+const uint8_t SCHEDULE_MAX_INTERVALS = 12;
+const uint16_t WEEK_MINUTES = 7 * 24 * 60;
+
+struct ScheduleInterval {
+  ScreenMask screens;   // bit per ScreenMode to rotate through, 0 for all
+  uint16_t start;       // minute of the day
+  uint16_t end;         // exclusive, 1..1440; at or before start runs into the next day
+  uint8_t days;         // bit per weekday the interval starts on, bit 0 = Sunday
+  uint8_t brightness;   // percent; 0 blanks the display
+  uint8_t reserved[2];  // explicit padding; records are compared and CRC'd bytewise
+};
+
+struct Schedule {
+  uint8_t count = 0;
+  ScheduleInterval intervals[SCHEDULE_MAX_INTERVALS];
+};
+
 struct AppState {
   ArduinoLEDMatrix matrix;
   WiFiClient wifiClient;
@@ -43,36 +104,51 @@ struct AppState {
   unsigned long mqttLastTryMs = 0;
   unsigned long wifiBackoffUntilMs = 0;
   unsigned long wifiBackoffMs = 0;
+  unsigned long mqttOkSinceMs = 0;
+  bool fastReconnect = false;            // retrying quietly after a drop
+  unsigned long mqttFirstTryDelayMs = 0;
+  bool wifiLeaseValid = false;
+  IPAddress wifiLeaseIp;
+  IPAddress wifiLeaseDns;
+  IPAddress wifiLeaseGateway;
+  IPAddress wifiLeaseSubnet;
+  uint8_t connectTokens = 0;
+  unsigned long connectTokenMs = 0;
+  ConnStats connStats;
 
   unsigned long screenStartMs = 0;
   unsigned long lastUiTickMs = 0;
   unsigned long lastRenderMs = 0;
-  ScreenMode mode = SCREEN_TEMP;
+  ScreenMode mode = 0;
 
   int wifiAnimStep = 0;
   unsigned long mqttPhase = 0;
 
   bool timeValid = false;
 
-  float lastTemp = NAN;
-  float lastHum  = NAN;
-  unsigned long lastTempUpdateMs = 0;
-  unsigned long lastHumUpdateMs = 0;
-  bool tempUpdatedSincePersist = false;
-  bool humUpdatedSincePersist = false;
+  SensorState sensors[SENSOR_COUNT];
+  SensorHistory history[SENSOR_COUNT];
   unsigned long lastPersistMs = 0;
   unsigned long showMs = SHOW_MS;
   unsigned long uiTickMs = UI_TICK_MS;
   unsigned long displayRefreshMs = DISPLAY_REFRESH_MS;
 
-  bool simTempEnabled = false;
-  bool simHumEnabled = false;
-  float simTemp = NAN;
-  float simHum = NAN;
   unsigned long simLastRefreshMs = 0;
 
-  uint8_t frame[8][12];
-
+  GrayFrame frame;
+  MatrixBam bam;
+  Frame lastPushedFrame;
+  bool lastPushedValid = false;
+  bool matrixAsleep = false;             // scan timer stopped for night mode
+  unsigned long framesPushed = 0;
+  unsigned long framesSkipped = 0;
+
+  Schedule schedule;
+  int8_t scheduleActive = -1;            // interval in effect, -1 for none
+  time_t scheduleEvalS = 0;              // local time of the last evaluation
+  time_t scheduleNextS = 0;              // local time of the next transition
+  uint8_t brightness = 100;              // percent, from the active interval
+  ScreenMask screenMask = 0;             // ScreenMode bits to rotate through, 0 for all
   bool displayOffForSchedule = false;
   int lastBlinkMinute = -1;
   unsigned long ledPulseUntilMs = 0;
@@ -0,0 +1,235 @@
+#include "bench.h"
+#include "ui.h"
+#include "matrix_io.h"
+
+#if defined(ARDUINO_ARCH_RENESAS) && defined(DWT)
+#define BENCH_HAS_CYCCNT 1
+#else
+#define BENCH_HAS_CYCCNT 0
+#endif
+
+struct BenchCase {
+  const char* name;
+  void (*setup)(AppState& s, unsigned long now);
+  void (*run)(AppState& s, unsigned long now, uint32_t i, uint8_t arg);
+  uint8_t arg;
+};
+
+static void setupFresh(AppState& s, unsigned long now) {
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    s.sensors[i].value = (SENSORS[i].minValue + SENSORS[i].maxValue) / 2;
+    s.sensors[i].updateMs = now;
+  }
+  s.sensors[SENSOR_TEMP].value = 2140;
+}
+
+static void setupNegative(AppState& s, unsigned long now) {
+  setupFresh(s, now);
+  s.sensors[SENSOR_TEMP].value = -730;
+}
+
+static void setupNoData(AppState& s, unsigned long now) {
+  (void)now;
+  for (SensorState& st : s.sensors) {
+    st.value = SENSOR_NO_VALUE;
+    st.updateMs = 0;
+  }
+}
+
+static void setupStale(AppState& s, unsigned long now) {
+  setupFresh(s, now);
+  for (SensorState& st : s.sensors) st.updateMs = 0;
+}
+
+// A full sparkline: one sample per bucket ending at now, plus the open bucket.
+static void setupHistory(AppState& s, unsigned long now) {
+  setupFresh(s, now);
+  for (SensorHistory& h : s.history) historyReset(h);
+  unsigned long t0 = now - (now % HISTORY_BUCKET_MS) - HISTORY_BUCKETS * HISTORY_BUCKET_MS;
+  for (uint8_t b = 0; b <= HISTORY_BUCKETS; b++) {
+    int32_t v = 2000 + (int32_t)((b * 37) % 11) * 25;
+    sensorStore(s, SENSOR_TEMP, v, t0 + b * HISTORY_BUCKET_MS);
+  }
+}
+
+// Keep the stale badge in its visible half of the blink period.
+static unsigned long badgeOnTime(unsigned long now) {
+  return now - (now % 800);
+}
+
+static void runSensor(AppState& s, unsigned long now, uint32_t i, uint8_t id) {
+  drawSensorScreen(s, (SensorId)id, badgeOnTime(now), i % s.showMs);
+}
+
+static void runTrend(AppState& s, unsigned long now, uint32_t i, uint8_t id) {
+  drawTrendScreen(s, (SensorId)id, badgeOnTime(now), i % s.showMs);
+}
+
+static void runClock(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)arg;
+  drawClockScreen(s, badgeOnTime(now), i % s.showMs);
+}
+
+static void runClockMinimal(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)arg;
+  drawClockMinimal(s, now, i);
+}
+
+static void runMqttAnim(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)now;
+  (void)arg;
+  drawMqttAnimSmooth(s, i);
+}
+
+static void runWifiAnim(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)now;
+  (void)arg;
+  drawWifiBarsAnim(s, (int)(i % 5));
+}
+
+static void runBigX(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)arg;
+  drawBigX(s, now + i * 450UL);
+}
+
+static void runStartWipe(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)i;
+  (void)arg;
+  startWipe(s, now, SENSOR_TEMP, SENSOR_HUM);
+}
+
+// One full 12-column wipe per iteration, reported per step.
+static void runTickWipe(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)i;
+  (void)arg;
+  startWipe(s, now, SENSOR_TEMP, SENSOR_HUM);
+  while (s.wipe.active) tickWipe(s, s.wipe.nextStepMs);
+}
+
+static void runPushChanged(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)now;
+  (void)arg;
+  s.frame.plane[0].w[0] = i;
+  matrixRenderBitmap(s, s.frame.plane[0]);
+}
+
+static void runPushSame(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)now;
+  (void)i;
+  (void)arg;
+  matrixRenderBitmap(s, s.frame.plane[0]);
+}
+
+// A dimmed frame per iteration: BAM slot rebuild plus the first slot push.
+static void runPushGray(AppState& s, unsigned long now, uint32_t i, uint8_t arg) {
+  (void)now;
+  (void)arg;
+  s.frame.plane[0].w[0] = i;
+  matrixRenderGray(s, s.frame);
+}
+
+static const BenchCase BENCH_CASES[] = {
+  {"temp",           setupFresh,    runSensor,       SENSOR_TEMP},
+  {"temp_negative",  setupNegative, runSensor,       SENSOR_TEMP},
+  {"temp_nan",       setupNoData,   runSensor,       SENSOR_TEMP},
+  {"temp_stale",     setupStale,    runSensor,       SENSOR_TEMP},
+  {"hum",            setupFresh,    runSensor,       SENSOR_HUM},
+  {"hum_nan",        setupNoData,   runSensor,       SENSOR_HUM},
+  {"temp_trend",     setupHistory,  runTrend,        SENSOR_TEMP},
+  {"clock",          setupStale,    runClock,        0},
+  {"clock_minimal",  setupFresh,    runClockMinimal, 0},
+  {"mqtt_anim",      setupFresh,    runMqttAnim,     0},
+  {"wifi_anim",      setupFresh,    runWifiAnim,     0},
+  {"big_x",          setupFresh,    runBigX,         0},
+  {"start_wipe",     setupFresh,    runStartWipe,    0},
+  {"tick_wipe",      setupFresh,    runTickWipe,     0},
+  {"push_changed",   setupFresh,    runPushChanged,  0},
+  {"push_same",      setupFresh,    runPushSame,     0},
+  {"push_gray",      setupFresh,    runPushGray,     0},
+};
+
+static void benchClockStart() {
+#if BENCH_HAS_CYCCNT
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static uint32_t benchCycles() {
+#if BENCH_HAS_CYCCNT
+  return DWT->CYCCNT;
+#else
+  return 0;
+#endif
+}
+
+void runRenderBench(AppState& s, uint32_t iterations) {
+  if (iterations == 0) iterations = 1;
+
+  SensorState savedSensors[SENSOR_COUNT];
+  SensorHistory savedHistory[SENSOR_COUNT];
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    savedSensors[i] = s.sensors[i];
+    savedHistory[i] = s.history[i];
+  }
+  ScreenMode savedMode = s.mode;
+  unsigned long savedScreenStartMs = s.screenStartMs;
+  unsigned long savedPushed = s.framesPushed;
+  unsigned long savedSkipped = s.framesSkipped;
+  WipeAnim savedWipe = s.wipe;
+
+  benchClockStart();
+
+  unsigned long uiCostNs = 0;
+  for (const BenchCase& c : BENCH_CASES) {
+    unsigned long now = millis();
+    c.setup(s, now);
+
+    uint32_t c0 = benchCycles();
+    unsigned long t0 = micros();
+    for (uint32_t i = 0; i < iterations; i++) c.run(s, now, i, c.arg);
+    unsigned long us = micros() - t0;
+    uint32_t cycles = benchCycles() - c0;
+
+    uint32_t perFrame = (c.run == runTickWipe) ? iterations * 12 : iterations;
+    unsigned long ns = (unsigned long)(((uint64_t)us * 1000ULL) / perFrame);
+    if ((c.run == runSensor || c.run == runTrend) && uiCostNs < ns) uiCostNs = ns;
+
+    Serial.print("bench ");
+    Serial.print(c.name);
+    Serial.print(" ns=");
+    Serial.print(ns);
+#if BENCH_HAS_CYCCNT
+    Serial.print(" cycles=");
+    Serial.print(cycles / perFrame);
+#else
+    (void)cycles;
+#endif
+    Serial.println();
+
+#if HAS_WDT
+    WDT.refresh();
+#endif
+  }
+
+  // Worst-case data screen cost against the current UI tick budget.
+  Serial.print("bench ui_load=");
+  Serial.print((float)uiCostNs / 10000.0f / (float)s.uiTickMs, 3);
+  Serial.print("% ui_tick_ms=");
+  Serial.print(s.uiTickMs);
+  Serial.print(" display_refresh_ms=");
+  Serial.println(s.displayRefreshMs);
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    s.sensors[i] = savedSensors[i];
+    s.history[i] = savedHistory[i];
+  }
+  s.mode = savedMode;
+  s.screenStartMs = savedScreenStartMs;
+  s.wipe = savedWipe;
+  s.framesPushed = savedPushed;
+  s.framesSkipped = savedSkipped;
+  s.lastUiTickMs = 0;
+  matrixInvalidate(s);
+}
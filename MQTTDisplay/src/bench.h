@@ -0,0 +1,7 @@
+#pragma once
+
+#include "app_state.h"
+
+// Times the rendering hot path on the device and prints one line per case.
+// Blocks the loop while it runs; app state touched by the cases is restored.
+void runRenderBench(AppState& s, uint32_t iterations);
@@ -1,83 +1,250 @@
 #include "connection.h"
 #include "mqtt_client.h"
 #include "ui.h"
+#include "scheduler.h"
+#include "anim.h"
+#include "sntp.h"
 
+// Wake for the end of a timed state; frame redraws schedule themselves.
+static void schedTimedState(unsigned long untilMs) {
+  schedAt(TASK_CONN, untilMs);
+}
+
+// xorshift32, seeded from the MAC on first use so displays that lost the
+// broker at the same moment pick different retry times.
+static uint32_t connRandom() {
+  static uint32_t state = 0;
+  if (state == 0) {
+    uint8_t mac[6] = {0};
+    WiFi.macAddress(mac);
+    uint32_t h = 2166136261UL;
+    for (uint8_t b : mac) h = (h ^ b) * 16777619UL;
+    state = (h ^ micros()) | 1;
+  }
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static unsigned long randomBetween(unsigned long lo, unsigned long hi) {
+  if (hi <= lo) return lo;
+  return lo + connRandom() % (hi - lo + 1);
+}
+
+// Decorrelated jitter: a random wait between base and three times the
+// previous one, capped at maxMs.
 static unsigned long nextBackoff(unsigned long current, unsigned long baseMs, unsigned long maxMs) {
-  if (current == 0) return baseMs;
-  unsigned long next = current * 2;
-  if (next < current) next = maxMs;
-  if (next > maxMs) next = maxMs;
-  return next;
+  unsigned long prev = current < baseMs ? baseMs : current;
+  unsigned long hi = (prev > maxMs / 3) ? maxMs : prev * 3;
+  unsigned long next = randomBetween(baseMs, hi);
+  return next > maxMs ? maxMs : next;
+}
+
+// Token bucket in front of MQTT connect attempts.
+static bool takeConnectToken(AppState& s, unsigned long now) {
+  unsigned long refills = (now - s.connectTokenMs) / MQTT_CONNECT_REFILL_MS;
+  if (s.connectTokens >= MQTT_CONNECT_BURST) {
+    s.connectTokenMs = now;
+  } else if (refills > 0) {
+    unsigned long tokens = s.connectTokens + refills;
+    s.connectTokens = tokens > MQTT_CONNECT_BURST ? MQTT_CONNECT_BURST : (uint8_t)tokens;
+    s.connectTokenMs += refills * MQTT_CONNECT_REFILL_MS;
+  }
+  if (s.connectTokens == 0) {
+    // Count each deferred attempt once, not every pass spent waiting.
+    static unsigned long lastThrottledMs = 0;
+    if (s.connStats.connectThrottled == 0 || lastThrottledMs != s.connectTokenMs) {
+      s.connStats.connectThrottled++;
+      lastThrottledMs = s.connectTokenMs;
+    }
+    schedAt(TASK_CONN, s.connectTokenMs + MQTT_CONNECT_REFILL_MS);
+    return false;
+  }
+  s.connectTokens--;
+  return true;
+}
+
+// Fast reconnect: while s.fastReconnect is set the connection states draw
+// nothing, so the last data screen stays up during a quick recovery.
+static void endFastReconnect(AppState& s) {
+  s.fastReconnect = false;
+}
+
+static void saveWifiLease(AppState& s) {
+  s.wifiLeaseIp = WiFi.localIP();
+  s.wifiLeaseDns = WiFi.dnsIP();
+  s.wifiLeaseGateway = WiFi.gatewayIP();
+  s.wifiLeaseSubnet = WiFi.subnetMask();
+  s.wifiLeaseValid = (uint32_t)s.wifiLeaseIp != 0;
+}
+
+static void drawWifiFrame(AppState& s, unsigned long now) {
+  (void)now;
+  drawWifiBarsAnim(s, s.wifiAnimStep % WIFI_ANIM_FRAMES);
+  s.wifiAnimStep++;
+}
+
+static void drawMqttFrame(AppState& s, unsigned long now) {
+  (void)now;
+  drawMqttAnimSmooth(s, s.mqttPhase++);
+}
+
+static void enterWifiWarmup(AppState& s, unsigned long now) {
+  (void)now;
+  s.wifiAnimStep = 0;
+}
+
+static void enterWifiBackoff(AppState& s, unsigned long now) {
+  endFastReconnect(s);
+  s.wifiBackoffMs = nextBackoff(s.wifiBackoffMs, WIFI_BACKOFF_BASE_MS, WIFI_BACKOFF_MAX_MS);
+  s.wifiBackoffUntilMs = now + s.wifiBackoffMs;
+}
+
+static void enterMqttAnim(AppState& s, unsigned long now) {
+  // WiFi is up and the loop is about to block on the broker anyway; this is
+  // the one place the NTP server's DNS lookup may wait.
+  sntpResolveServer();
+  s.mqttPhase = 0;
+  s.mqttSessionStartMs = now;
+  s.mqttLastTryMs = 0;
+  s.mqttFirstTryDelayMs = s.fastReconnect ? 0 : MQTT_ANIM_RUN_MS;
+}
+
+static void enterMqttFailed(AppState& s, unsigned long now) {
+  (void)now;
+  endFastReconnect(s);
+}
+
+static void enterMqttBackoff(AppState& s, unsigned long now) {
+  endFastReconnect(s);
+  s.mqttBackoffMs = nextBackoff(s.mqttBackoffMs, MQTT_SESSION_BACKOFF_BASE_MS, MQTT_SESSION_BACKOFF_MAX_MS);
+  s.mqttBackoffUntilMs = now + s.mqttBackoffMs;
+}
+
+static void enterOk(AppState& s, unsigned long now) {
+  endFastReconnect(s);
+  s.mqttBackoffMs = 0;
+  s.mqttOkSinceMs = now;
+
+  ConnStats& st = s.connStats;
+  if (!st.outage) return;
+  st.outage = false;
+  st.reconnects++;
+  st.lastReconnectMs = now - st.outageStartMs;
+  st.totalReconnectMs += st.lastReconnectMs;
+  if (st.lastReconnectMs > st.maxReconnectMs) st.maxReconnectMs = st.lastReconnectMs;
+}
+
+static void exitOk(AppState& s, unsigned long now) {
+  s.mqttClient.stop();
+  s.fastReconnect = FAST_RECONNECT && (now - s.mqttOkSinceMs) >= MQTT_STABLE_SESSION_MS;
+  s.connStats.outage = true;
+  s.connStats.outageStartMs = now;
+}
+
+// What each state shows and does on entry/exit. A state with a drawFrame
+// redraws only when now / frameMs changes, so the big X repaints once per
+// pulse instead of on every loop pass.
+struct ConnStateDef {
+  const char* name;
+  void (*drawFrame)(AppState& s, unsigned long now);
+  unsigned long frameMs;
+  void (*onEnter)(AppState& s, unsigned long now);
+  void (*onExit)(AppState& s, unsigned long now);
+};
+
+static const ConnStateDef CONN_STATES[] = {
+  {"CONN_WIFI_WARMUP",          drawWifiFrame, WIFI_CONNECT_TICK_MS, enterWifiWarmup,  nullptr},
+  {"CONN_WIFI_BEGIN",           nullptr,       0,                    nullptr,          nullptr},
+  {"CONN_WIFI_WAIT",            drawWifiFrame, WIFI_CONNECT_TICK_MS, nullptr,          nullptr},
+  {"CONN_WIFI_BACKOFF",         drawBigX,      BIG_X_PULSE_MS,       enterWifiBackoff, nullptr},
+  {"CONN_MQTT_ANIM",            drawMqttFrame, MQTT_CONNECT_TICK_MS, enterMqttAnim,    nullptr},
+  {"CONN_MQTT_TRY_ONCE",        nullptr,       0,                    nullptr,          nullptr},
+  {"CONN_MQTT_FAIL_SHOW",       drawBigX,      BIG_X_PULSE_MS,       enterMqttFailed,  nullptr},
+  {"CONN_MQTT_SESSION_BACKOFF", drawBigX,      BIG_X_PULSE_MS,       enterMqttBackoff, nullptr},
+  {"CONN_OK",                   nullptr,       0,                    enterOk,          exitOk},
+};
+
+static_assert(sizeof(CONN_STATES) / sizeof(CONN_STATES[0]) == CONN_OK + 1,
+              "CONN_STATES must have one entry per ConnState");
+
+static void drawStateFrame(AppState& s, const ConnStateDef& def, unsigned long now) {
+  if (s.fastReconnect) return;
+  def.drawFrame(s, now);
+  s.lastAnimTickMs = now;
+  schedAt(TASK_CONN, (now / def.frameMs + 1) * def.frameMs);
+}
+
+static void tickStateFrame(AppState& s, unsigned long now) {
+  const ConnStateDef& def = CONN_STATES[s.connState];
+  if (!def.drawFrame || s.fastReconnect) return;
+  if (now / def.frameMs == s.lastAnimTickMs / def.frameMs) {
+    schedAt(TASK_CONN, (now / def.frameMs + 1) * def.frameMs);
+    return;
+  }
+  drawStateFrame(s, def, now);
 }
 
 void goState(AppState& s, ConnState next, unsigned long now) {
+  const ConnStateDef& from = CONN_STATES[s.connState];
+  const ConnStateDef& to = CONN_STATES[next];
+  if (from.onExit) from.onExit(s, now);
+
   s.connState = next;
   s.stateStartMs = now;
-  s.lastAnimTickMs = 0;
+  if (to.onEnter) to.onEnter(s, now);
+  if (to.drawFrame) drawStateFrame(s, to, now);
+  schedAt(TASK_CONN, now);
 #if SERIAL_DEBUG
-  const char* name = "UNKNOWN";
-  switch (next) {
-    case CONN_WIFI_WARMUP: name = "CONN_WIFI_WARMUP"; break;
-    case CONN_WIFI_BEGIN: name = "CONN_WIFI_BEGIN"; break;
-    case CONN_WIFI_WAIT: name = "CONN_WIFI_WAIT"; break;
-    case CONN_WIFI_BACKOFF: name = "CONN_WIFI_BACKOFF"; break;
-    case CONN_MQTT_ANIM: name = "CONN_MQTT_ANIM"; break;
-    case CONN_MQTT_TRY_ONCE: name = "CONN_MQTT_TRY_ONCE"; break;
-    case CONN_MQTT_FAIL_SHOW: name = "CONN_MQTT_FAIL_SHOW"; break;
-    case CONN_MQTT_SESSION_BACKOFF: name = "CONN_MQTT_SESSION_BACKOFF"; break;
-    case CONN_OK: name = "CONN_OK"; break;
-    default: break;
-  }
   Serial.print("State -> ");
-  Serial.println(name);
+  Serial.println(to.name);
 #endif
 }
 
+// connect + subscribe + online status; false leaves the client stopped.
+static bool mqttConnectSession(AppState& s) {
+  s.connStats.connectAttempts++;
+  if (!s.mqttClient.connect(MQTT_BROKER, MQTT_PORT)) return false;
+  if (!mqttSubscribeOnce(s)) {
+    s.mqttClient.stop();
+    return false;
+  }
+  mqttPublishStatusOnline(s);
+  return true;
+}
+
 void connectionTick(AppState& s, unsigned long now) {
   if (s.connState == CONN_OK && WiFi.status() != WL_CONNECTED) {
-    s.mqttClient.stop();
-    s.wifiAnimStep = 0;
     goState(s, CONN_WIFI_WARMUP, now);
     return;
   }
 
   if (s.connState == CONN_OK && !s.mqttClient.connected()) {
-    s.mqttPhase = 0;
-    s.mqttSessionStartMs = now;
-    s.mqttLastTryMs = 0;
     goState(s, CONN_MQTT_ANIM, now);
     return;
   }
 
-  auto wifiAnim = [&]() {
-    if (now - s.lastAnimTickMs >= WIFI_CONNECT_TICK_MS) {
-      s.lastAnimTickMs = now;
-      drawWifiBarsAnim(s, s.wifiAnimStep % 5);
-      s.wifiAnimStep++;
-    }
-  };
-
-  auto mqttAnim = [&]() {
-    if (now - s.lastAnimTickMs >= MQTT_CONNECT_TICK_MS) {
-      s.lastAnimTickMs = now;
-      drawMqttAnimSmooth(s, s.mqttPhase++);
-    }
-  };
+  tickStateFrame(s, now);
 
   switch (s.connState) {
     case CONN_WIFI_WARMUP: {
-      if (s.stateStartMs == 0) {
-        s.stateStartMs = now;
-        drawWifiBarsAnim(s, 0);
+      if (s.stateStartMs == 0) s.stateStartMs = now;
+      if (s.fastReconnect) {
+        goState(s, CONN_WIFI_BEGIN, now);
+        break;
       }
-      wifiAnim();
       if (now - s.stateStartMs >= WIFI_WARMUP_ANIM_MS) goState(s, CONN_WIFI_BEGIN, now);
+      else schedTimedState(s.stateStartMs + WIFI_WARMUP_ANIM_MS);
       break;
     }
 
     case CONN_WIFI_BEGIN: {
       if (USE_STATIC_IP) {
         WiFi.config(WIFI_STATIC_IP, WIFI_DNS, WIFI_GATEWAY, WIFI_SUBNET);
+      } else if (FAST_RECONNECT_REUSE_LEASE && s.fastReconnect && s.wifiLeaseValid) {
+        // Rejoin with the previous lease instead of waiting on DHCP.
+        WiFi.config(s.wifiLeaseIp, s.wifiLeaseDns, s.wifiLeaseGateway, s.wifiLeaseSubnet);
       }
       WiFi.begin(WIFI_SSID, WIFI_PASS);
       goState(s, CONN_WIFI_WAIT, now);
@@ -85,113 +252,79 @@ void connectionTick(AppState& s, unsigned long now) {
     }
 
     case CONN_WIFI_WAIT: {
-      wifiAnim();
-
       if (WiFi.status() == WL_CONNECTED) {
         s.wifiBackoffMs = 0;
+        if (!USE_STATIC_IP && FAST_RECONNECT_REUSE_LEASE) saveWifiLease(s);
         mqttConfigureOnce(s);
-
-        s.mqttPhase = 0;
-        s.mqttSessionStartMs = now;
-        s.mqttLastTryMs = 0;
         goState(s, CONN_MQTT_ANIM, now);
-        drawMqttAnimSmooth(s, 0);
-
         break;
       }
 
-      if (now - s.stateStartMs >= WIFI_TIMEOUT_MS) {
-        drawBigX(s, now);
-        s.wifiBackoffMs = nextBackoff(s.wifiBackoffMs, WIFI_BACKOFF_BASE_MS, WIFI_BACKOFF_MAX_MS);
-        s.wifiBackoffUntilMs = now + s.wifiBackoffMs;
-        goState(s, CONN_WIFI_BACKOFF, now);
+      if (s.fastReconnect) {
+        if (now - s.stateStartMs >= WIFI_FAST_TIMEOUT_MS) {
+          // The old lease may be stale; fall back to a normal DHCP join.
+          endFastReconnect(s);
+          s.wifiLeaseValid = false;
+          WiFi.disconnect();
+          goState(s, CONN_WIFI_WARMUP, now);
+        } else {
+          schedTimedState(s.stateStartMs + WIFI_FAST_TIMEOUT_MS);
+        }
+        break;
       }
+      if (now - s.stateStartMs >= WIFI_TIMEOUT_MS) goState(s, CONN_WIFI_BACKOFF, now);
       break;
     }
 
     case CONN_WIFI_BACKOFF: {
-      drawBigX(s, now);
-      if ((long)(now - s.wifiBackoffUntilMs) >= 0) {
-        s.wifiAnimStep = 0;
-        goState(s, CONN_WIFI_WARMUP, now);
-        drawWifiBarsAnim(s, 0);
-      }
+      if ((long)(now - s.wifiBackoffUntilMs) >= 0) goState(s, CONN_WIFI_WARMUP, now);
+      else schedTimedState(s.wifiBackoffUntilMs);
       break;
     }
 
     case CONN_MQTT_ANIM: {
-      mqttAnim();
-
       if (MQTT_TOTAL_TIMEOUT_MS > 0 && (now - s.mqttSessionStartMs >= MQTT_TOTAL_TIMEOUT_MS)) {
-        drawBigX(s, now);
-        s.mqttBackoffMs = nextBackoff(s.mqttBackoffMs, MQTT_SESSION_BACKOFF_BASE_MS, MQTT_SESSION_BACKOFF_MAX_MS);
-        s.mqttBackoffUntilMs = now + s.mqttBackoffMs;
         goState(s, CONN_MQTT_SESSION_BACKOFF, now);
         break;
       }
 
-      if (now - s.stateStartMs >= MQTT_ANIM_RUN_MS) {
-        if (s.mqttLastTryMs == 0 || now - s.mqttLastTryMs >= MQTT_TRY_INTERVAL_MS) {
-          s.mqttLastTryMs = now;
-          bool ok = s.mqttClient.connect(MQTT_BROKER, MQTT_PORT);
-          if (ok) {
-            bool subOk = mqttSubscribeOnce(s);
-            if (subOk) {
-              mqttPublishStatusOnline(s);
-              s.mqttBackoffMs = 0;
-              goState(s, CONN_OK, now);
-            } else {
-              s.mqttClient.stop();
-            }
-          }
-        }
+      if (now - s.stateStartMs < s.mqttFirstTryDelayMs) {
+        schedTimedState(s.stateStartMs + s.mqttFirstTryDelayMs);
+        break;
+      }
+      if (s.mqttLastTryMs != 0 && now - s.mqttLastTryMs < MQTT_TRY_INTERVAL_MS) {
+        schedTimedState(s.mqttLastTryMs + MQTT_TRY_INTERVAL_MS);
+        break;
+      }
+      if (!takeConnectToken(s, now)) break;
+      s.mqttLastTryMs = now;
+      if (mqttConnectSession(s)) {
+        goState(s, CONN_OK, now);
+      } else if (s.fastReconnect) {
+        // Quick retry failed: show the animation for the regular attempts.
+        endFastReconnect(s);
+        drawStateFrame(s, CONN_STATES[CONN_MQTT_ANIM], now);
       }
       break;
     }
 
     case CONN_MQTT_TRY_ONCE: {
-      bool ok = s.mqttClient.connect(MQTT_BROKER, MQTT_PORT);
-      if (ok) {
-        bool subOk = mqttSubscribeOnce(s);
-        if (subOk) {
-          mqttPublishStatusOnline(s);
-          s.mqttBackoffMs = 0;
-          goState(s, CONN_OK, now);
-        } else {
-          s.mqttClient.stop();
-          drawBigX(s, now);
-          goState(s, CONN_MQTT_FAIL_SHOW, now);
-        }
-      } else {
-        drawBigX(s, now);
-        goState(s, CONN_MQTT_FAIL_SHOW, now);
-      }
+      if (!takeConnectToken(s, now)) break;
+      goState(s, mqttConnectSession(s) ? CONN_OK : CONN_MQTT_FAIL_SHOW, now);
       break;
     }
 
     case CONN_MQTT_FAIL_SHOW: {
-      drawBigX(s, now);
-      if (now - s.stateStartMs >= MQTT_FAIL_SHOW_MS) {
-        s.mqttBackoffMs = nextBackoff(s.mqttBackoffMs, MQTT_SESSION_BACKOFF_BASE_MS, MQTT_SESSION_BACKOFF_MAX_MS);
-        s.mqttBackoffUntilMs = now + s.mqttBackoffMs;
-        goState(s, CONN_MQTT_SESSION_BACKOFF, now);
-      }
+      if (now - s.stateStartMs >= MQTT_FAIL_SHOW_MS) goState(s, CONN_MQTT_SESSION_BACKOFF, now);
+      else schedTimedState(s.stateStartMs + MQTT_FAIL_SHOW_MS);
       break;
     }
 
     case CONN_MQTT_SESSION_BACKOFF: {
-      drawBigX(s, now);
       if ((long)(now - s.mqttBackoffUntilMs) >= 0) {
-        if (WiFi.status() != WL_CONNECTED) {
-          s.wifiAnimStep = 0;
-          goState(s, CONN_WIFI_WARMUP, now);
-          drawWifiBarsAnim(s, 0);
-        } else {
-          s.mqttPhase = 0;
-          s.mqttSessionStartMs = now;
-          goState(s, CONN_MQTT_ANIM, now);
-          drawMqttAnimSmooth(s, 0);
-        }
+        goState(s, WiFi.status() != WL_CONNECTED ? CONN_WIFI_WARMUP : CONN_MQTT_ANIM, now);
+      } else {
+        schedTimedState(s.mqttBackoffUntilMs);
       }
       break;
     }
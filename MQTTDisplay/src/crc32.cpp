@@ -0,0 +1,22 @@
+#include "crc32.h"
+
+struct Crc32Table {
+  uint32_t v[256];
+
+  constexpr Crc32Table() : v() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (uint8_t b = 0; b < 8; b++) c = (c & 1) ? (c >> 1) ^ 0xEDB88320UL : (c >> 1);
+      v[i] = c;
+    }
+  }
+};
+
+static constexpr Crc32Table CRC32_TABLE;
+
+uint32_t crc32(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t crc = 0xFFFFFFFFUL;
+  while (len--) crc = CRC32_TABLE.v[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected 0xEDB88320), byte-at-a-time table lookup.
+uint32_t crc32(const void* data, size_t len);
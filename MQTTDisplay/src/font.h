@@ -1,5 +1,6 @@
 #pragma once
 
+#include "platform.h"
 #include "../config.h"
 
 extern const uint8_t F_0[5] PROGMEM;
@@ -0,0 +1,16 @@
+#include "frame.h"
+
+const Frame FRAME_COLUMN_MASK[FRAME_W] = {
+  {{0x80080080UL, 0x08008008UL, 0x00800800UL}},
+  {{0x40040040UL, 0x04004004UL, 0x00400400UL}},
+  {{0x20020020UL, 0x02002002UL, 0x00200200UL}},
+  {{0x10010010UL, 0x01001001UL, 0x00100100UL}},
+  {{0x08008008UL, 0x00800800UL, 0x80080080UL}},
+  {{0x04004004UL, 0x00400400UL, 0x40040040UL}},
+  {{0x02002002UL, 0x00200200UL, 0x20020020UL}},
+  {{0x01001001UL, 0x00100100UL, 0x10010010UL}},
+  {{0x00800800UL, 0x80080080UL, 0x08008008UL}},
+  {{0x00400400UL, 0x40040040UL, 0x04004004UL}},
+  {{0x00200200UL, 0x20020020UL, 0x02002002UL}},
+  {{0x00100100UL, 0x10010010UL, 0x01001001UL}}
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdint.h>
+
+const int FRAME_W = 12;
+const int FRAME_H = 8;
+
+// Packed 12x8 frame in the LED matrix's native layout: pixel (x, y) is
+// bit (31 - i % 32) of word i / 32 with i = y * 12 + x, so a frame can be
+// handed to ArduinoLEDMatrix::loadFrame without conversion.
+struct Frame {
+  uint32_t w[3];
+};
+
+// Mask of all 8 pixels in one column, indexed by x.
+extern const Frame FRAME_COLUMN_MASK[FRAME_W];
+
+constexpr void frameClear(Frame& f) {
+  f.w[0] = 0;
+  f.w[1] = 0;
+  f.w[2] = 0;
+}
+
+inline void frameCopy(Frame& dst, const Frame& src) {
+  dst.w[0] = src.w[0];
+  dst.w[1] = src.w[1];
+  dst.w[2] = src.w[2];
+}
+
+constexpr void frameSetPixel(Frame& f, int x, int y, bool on) {
+  if (x < 0 || x >= FRAME_W || y < 0 || y >= FRAME_H) return;
+  uint8_t i = (uint8_t)(y * FRAME_W + x);
+  uint32_t bit = 0x80000000UL >> (i & 31);
+  if (on) f.w[i >> 5] |= bit;
+  else    f.w[i >> 5] &= ~bit;
+}
+
+inline bool frameGetPixel(const Frame& f, int x, int y) {
+  if (x < 0 || x >= FRAME_W || y < 0 || y >= FRAME_H) return false;
+  uint8_t i = (uint8_t)(y * FRAME_W + x);
+  return (f.w[i >> 5] & (0x80000000UL >> (i & 31))) != 0;
+}
+
+// dst |= src
+inline void frameOr(Frame& dst, const Frame& src) {
+  dst.w[0] |= src.w[0];
+  dst.w[1] |= src.w[1];
+  dst.w[2] |= src.w[2];
+}
+
+// dst &= mask
+inline void frameMask(Frame& dst, const Frame& mask) {
+  dst.w[0] &= mask.w[0];
+  dst.w[1] &= mask.w[1];
+  dst.w[2] &= mask.w[2];
+}
+
+// Copy the pixels selected by mask from src into dst, leave the rest.
+inline void frameBlit(Frame& dst, const Frame& src, const Frame& mask) {
+  dst.w[0] = (dst.w[0] & ~mask.w[0]) | (src.w[0] & mask.w[0]);
+  dst.w[1] = (dst.w[1] & ~mask.w[1]) | (src.w[1] & mask.w[1]);
+  dst.w[2] = (dst.w[2] & ~mask.w[2]) | (src.w[2] & mask.w[2]);
+}
+
+inline bool frameEqual(const Frame& a, const Frame& b) {
+  return a.w[0] == b.w[0] && a.w[1] == b.w[1] && a.w[2] == b.w[2];
+}
+
+// Grayscale frame as GRAY_BITS bit planes: plane b holds bit b of every
+// pixel's level (0..GRAY_MAX). Each plane is a packed Frame, so the mask
+// helpers above work per plane and a plane can be loaded as is.
+const uint8_t GRAY_BITS = 2;
+const uint8_t GRAY_MAX = (1u << GRAY_BITS) - 1;
+
+struct GrayFrame {
+  Frame plane[GRAY_BITS];
+};
+
+inline void grayClear(GrayFrame& g) {
+  for (Frame& p : g.plane) frameClear(p);
+}
+
+inline void grayCopy(GrayFrame& dst, const GrayFrame& src) {
+  for (uint8_t b = 0; b < GRAY_BITS; b++) frameCopy(dst.plane[b], src.plane[b]);
+}
+
+// Every plane set to f: lit pixels at GRAY_MAX, the rest off.
+inline void grayFromFrame(GrayFrame& dst, const Frame& f) {
+  for (Frame& p : dst.plane) frameCopy(p, f);
+}
+
+inline void graySetPixel(GrayFrame& g, int x, int y, uint8_t level) {
+  for (uint8_t b = 0; b < GRAY_BITS; b++) frameSetPixel(g.plane[b], x, y, (level >> b) & 1);
+}
+
+inline uint8_t grayGetPixel(const GrayFrame& g, int x, int y) {
+  uint8_t level = 0;
+  for (uint8_t b = 0; b < GRAY_BITS; b++) level |= (uint8_t)(frameGetPixel(g.plane[b], x, y) << b);
+  return level;
+}
+
+inline void grayBlit(GrayFrame& dst, const GrayFrame& src, const Frame& mask) {
+  for (uint8_t b = 0; b < GRAY_BITS; b++) frameBlit(dst.plane[b], src.plane[b], mask);
+}
+
+inline bool grayEqual(const GrayFrame& a, const GrayFrame& b) {
+  for (uint8_t i = 0; i < GRAY_BITS; i++) {
+    if (!frameEqual(a.plane[i], b.plane[i])) return false;
+  }
+  return true;
+}
+
+// True if every pixel is either off or at GRAY_MAX.
+inline bool grayIsBinary(const GrayFrame& g) {
+  for (uint8_t b = 1; b < GRAY_BITS; b++) {
+    if (!frameEqual(g.plane[b], g.plane[0])) return false;
+  }
+  return true;
+}
+
+// Writes (a + b) / 2 into the pixels selected by mask: a ripple-carry add
+// over the planes, 32 pixels per word, dropping the lowest sum bit.
+inline void grayAverage(GrayFrame& dst, const GrayFrame& a, const GrayFrame& b, const Frame& mask) {
+  for (uint8_t w = 0; w < 3; w++) {
+    uint32_t carry = 0;
+    uint32_t sum[GRAY_BITS + 1];
+    for (uint8_t p = 0; p < GRAY_BITS; p++) {
+      uint32_t x = a.plane[p].w[w];
+      uint32_t y = b.plane[p].w[w];
+      sum[p] = x ^ y ^ carry;
+      carry = (x & y) | (carry & (x ^ y));
+    }
+    sum[GRAY_BITS] = carry;
+    for (uint8_t p = 0; p < GRAY_BITS; p++) {
+      uint32_t& d = dst.plane[p].w[w];
+      d = (d & ~mask.w[w]) | (sum[p + 1] & mask.w[w]);
+    }
+  }
+}
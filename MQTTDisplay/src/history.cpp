@@ -0,0 +1,123 @@
+#include "history.h"
+#include "sensors.h"
+
+// How many closed buckets back the trend arrow looks.
+const uint8_t HISTORY_TREND_BUCKETS = 3;
+
+static int32_t deltaSteps(const SensorHistory& h, int32_t step, int32_t value) {
+  return sensorRoundDiv(value - h.base, step);
+}
+
+static int8_t clampDelta(int32_t d) {
+  if (d < -127) return -127;
+  if (d > 127) return 127;
+  return (int8_t)d;
+}
+
+static bool anyClosed(const SensorHistory& h) {
+  for (const HistoryBucket& b : h.buckets) {
+    if (b.avg != HISTORY_EMPTY) return true;
+  }
+  return false;
+}
+
+// Moves base to newBase (on the step grid) and shifts the stored deltas.
+// Only runs when a closed bucket would not fit in 8 bits.
+static void rebase(SensorHistory& h, int32_t step, int32_t newBase) {
+  int32_t shift = deltaSteps(h, step, newBase);
+  for (HistoryBucket& b : h.buckets) {
+    if (b.avg == HISTORY_EMPTY) continue;
+    b.avg = clampDelta(b.avg - shift);
+    b.lo = clampDelta(b.lo - shift);
+    b.hi = clampDelta(b.hi - shift);
+  }
+  h.base += shift * step;
+}
+
+static void pushBucket(SensorHistory& h, int32_t step, int32_t avg, int32_t lo, int32_t hi) {
+  if (!anyClosed(h)) {
+    h.base = avg;
+  } else if (abs(deltaSteps(h, step, lo)) > 127 || abs(deltaSteps(h, step, hi)) > 127) {
+    rebase(h, step, avg);
+  }
+  HistoryBucket& b = h.buckets[h.head];
+  b.avg = clampDelta(deltaSteps(h, step, avg));
+  b.lo = clampDelta(deltaSteps(h, step, lo));
+  b.hi = clampDelta(deltaSteps(h, step, hi));
+  h.head = (uint8_t)((h.head + 1) % HISTORY_BUCKETS);
+}
+
+static void pushEmpty(SensorHistory& h) {
+  h.buckets[h.head].avg = HISTORY_EMPTY;
+  h.head = (uint8_t)((h.head + 1) % HISTORY_BUCKETS);
+}
+
+void historyReset(SensorHistory& h) {
+  h = SensorHistory();
+  for (HistoryBucket& b : h.buckets) b.avg = HISTORY_EMPTY;
+}
+
+void historyAdvance(SensorHistory& h, int32_t step, unsigned long now) {
+  // Only the unsigned distance from the open bucket's start matters, so
+  // millis() wrapping does not look like a jump across the whole history.
+  unsigned long elapsed = now - h.openStartMs;
+  if (elapsed < HISTORY_BUCKET_MS) return;
+
+  if (h.openCount == 0) {
+    pushEmpty(h);
+  } else {
+    int32_t avg = (int32_t)((h.openSum + (h.openSum < 0 ? -(h.openCount / 2) : h.openCount / 2)) / h.openCount);
+    pushBucket(h, step, avg, h.openMin, h.openMax);
+  }
+  // Buckets that passed without any sample.
+  unsigned long passed = elapsed / HISTORY_BUCKET_MS;
+  unsigned long missed = passed - 1;
+  if (missed > HISTORY_BUCKETS) missed = HISTORY_BUCKETS;
+  while (missed--) pushEmpty(h);
+
+  h.openStartMs += passed * HISTORY_BUCKET_MS;
+  h.openSum = 0;
+  h.openCount = 0;
+}
+
+void historyAdd(SensorHistory& h, int32_t step, int32_t value, unsigned long now) {
+  historyAdvance(h, step, now);
+  if (h.openCount == 0) {
+    h.openMin = value;
+    h.openMax = value;
+  } else {
+    if (value < h.openMin) h.openMin = value;
+    if (value > h.openMax) h.openMax = value;
+  }
+  if (h.openCount < UINT16_MAX) {
+    h.openSum += value;
+    h.openCount++;
+  }
+}
+
+bool historyColumn(const SensorHistory& h, int32_t step, uint8_t col,
+                   int32_t& lo, int32_t& hi) {
+  if (col >= HISTORY_BUCKETS) {
+    if (h.openCount == 0) return false;
+    lo = h.openMin;
+    hi = h.openMax;
+    return true;
+  }
+  const HistoryBucket& b = h.buckets[(h.head + col) % HISTORY_BUCKETS];
+  if (b.avg == HISTORY_EMPTY) return false;
+  lo = h.base + b.lo * step;
+  hi = h.base + b.hi * step;
+  return true;
+}
+
+int8_t historyTrend(const SensorHistory& h, int32_t step, int32_t current) {
+  for (uint8_t back = HISTORY_TREND_BUCKETS; back > 0; back--) {
+    const HistoryBucket& b = h.buckets[(h.head + HISTORY_BUCKETS - back) % HISTORY_BUCKETS];
+    if (b.avg == HISTORY_EMPTY) continue;
+    int32_t diff = current - (h.base + b.avg * step);
+    if (diff >= 2 * step) return 1;
+    if (diff <= -2 * step) return -1;
+    return 0;
+  }
+  return 0;
+}
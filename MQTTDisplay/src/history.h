@@ -0,0 +1,37 @@
+#pragma once
+
+#include "platform.h"
+#include "../config.h"
+#include "frame.h"
+
+// Per-sensor history for the trend screen: one column per HISTORY_BUCKET_MS.
+// Samples only update the open bucket's running sum/min/max; closed buckets
+// are kept as 8-bit deltas from 'base' in units of the sensor's history step.
+const uint8_t HISTORY_BUCKETS = FRAME_W - 1;  // closed; the open bucket is the last column
+const int8_t HISTORY_EMPTY = INT8_MIN;
+
+struct HistoryBucket {
+  int8_t avg;  // HISTORY_EMPTY if no samples arrived in this bucket
+  int8_t lo;
+  int8_t hi;
+};
+
+struct SensorHistory {
+  int32_t base = 0;
+  HistoryBucket buckets[HISTORY_BUCKETS];
+  uint8_t head = 0;           // oldest closed bucket
+  unsigned long openStartMs = 0;  // start of the open bucket
+  int64_t openSum = 0;
+  uint16_t openCount = 0;
+  int32_t openMin = 0;
+  int32_t openMax = 0;
+};
+
+void historyReset(SensorHistory& h);
+void historyAdvance(SensorHistory& h, int32_t step, unsigned long now);
+void historyAdd(SensorHistory& h, int32_t step, int32_t value, unsigned long now);
+// Column 0 is the oldest bucket, FRAME_W - 1 the open one. False if empty.
+bool historyColumn(const SensorHistory& h, int32_t step, uint8_t col,
+                   int32_t& lo, int32_t& hi);
+// -1, 0 or +1: current value against the recent closed buckets.
+int8_t historyTrend(const SensorHistory& h, int32_t step, int32_t current);
@@ -2,6 +2,17 @@
 
 #include "app_state.h"
 
-void matrixRenderBitmap(AppState& s, uint8_t bitmap[8][12]);
-void matrixRenderBitmapConst(AppState& s, const uint8_t bitmap[8][12]);
+void matrixRenderBitmap(AppState& s, const Frame& f);
+// Shows a grayscale frame at s.brightness. A frame that is still binary
+// after brightness scaling is loaded directly; anything else starts the
+// BAM refresh.
+void matrixRenderGray(AppState& s, const GrayFrame& g);
+// True if g (or the brightness) differs from what the matrix shows.
+bool matrixNeedsRender(const AppState& s, const GrayFrame& g);
+// Advances the BAM refresh to its next slot when due.
+void matrixRefreshTick(AppState& s, unsigned long now);
+void matrixInvalidate(AppState& s);
 bool matrixInit(AppState& s);
+// Blanks the matrix and stops its scan timer; matrixWake restarts it.
+void matrixSleep(AppState& s);
+bool matrixWake(AppState& s);
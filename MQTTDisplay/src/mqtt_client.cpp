@@ -1,53 +1,225 @@
 #include "mqtt_client.h"
+#include "perf.h"
+#include "scheduler.h"
+#include "schedule.h"
+
+const size_t MQTT_TOPIC_MAX = 96;
+const size_t MQTT_PAYLOAD_MAX = 32;
 
 static AppState* gAppState = nullptr;
 
+// Topic hashes by sensor id, filled in by mqttBindState.
+static uint32_t sensorTopicHash[SENSOR_COUNT];
+static uint32_t scheduleTopicHash = 0;
+
+// Recently applied QoS1 messages, keyed by topic + payload hash. The library
+// does not expose packet ids, so a redelivery (DUP flag set) is matched on
+// content within MQTT_DEDUP_WINDOW_MS instead.
+const uint8_t MQTT_DEDUP_SLOTS = 8;
+
+struct DedupSlot {
+  uint32_t key;
+  unsigned long ms;
+};
+
+static DedupSlot dedupSlots[MQTT_DEDUP_SLOTS];
+static uint8_t dedupNext = 0;
+
+// Readings parsed during one poll pass; only the latest per sensor is stored.
+struct PendingValue {
+  int32_t value;
+  bool valid;
+};
+
+static PendingValue pending[SENSOR_COUNT];
+static unsigned long messagesSeen = 0;
+// Doubles after each pass that read nothing, up to MQTT_POLL_IDLE_MAX_MS.
+static unsigned long pollIntervalMs = MQTT_POLL_INTERVAL_MS;
+
+// FNV-1a, one step per topic byte.
+static inline uint32_t topicHashStep(uint32_t h, char c) {
+  return (h ^ (uint8_t)c) * 16777619UL;
+}
+
+static uint32_t topicHash(const char* topic) {
+  uint32_t h = 2166136261UL;
+  while (*topic) h = topicHashStep(h, *topic++);
+  return h;
+}
+
 void mqttBindState(AppState& s) {
   gAppState = &s;
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) sensorTopicHash[i] = topicHash(SENSORS[i].topic);
+  scheduleTopicHash = topicHash(TOPIC_SCHEDULE);
 }
 
-void onMqttMessage(int) {
-  if (!gAppState) return;
-  AppState& s = *gAppState;
+// Copies the topic into a stack buffer and hashes it on the way. The
+// library only hands the topic out as a String copy; it is kept in this
+// scope so it is freed before anything else can allocate.
+static bool readTopic(AppState& s, char* topic, size_t cap, uint32_t& hash) {
+  const String t = s.mqttClient.messageTopic();
+  const char* src = t.c_str();
+  uint32_t h = 2166136261UL;
+  size_t n = 0;
+  while (src[n]) {
+    if (n >= cap - 1) return false;
+    h = topicHashStep(h, src[n]);
+    topic[n] = src[n];
+    n++;
+  }
+  topic[n] = '\0';
+  hash = h;
+  return true;
+}
+
+static bool isRecentMessage(uint32_t key, unsigned long now) {
+  for (const DedupSlot& d : dedupSlots) {
+    if (d.ms != 0 && d.key == key && now - d.ms < MQTT_DEDUP_WINDOW_MS) return true;
+  }
+  return false;
+}
+
+static void rememberMessage(uint32_t key, unsigned long now) {
+  dedupSlots[dedupNext] = {key, now ? now : 1};
+  dedupNext = (uint8_t)((dedupNext + 1) % MQTT_DEDUP_SLOTS);
+}
 
-  const String topicStr = s.mqttClient.messageTopic();
-  const char* topic = topicStr.c_str();
+static uint8_t sensorForTopic(const char* topic, uint32_t hash) {
+  uint8_t id = 0;
+  while (id < SENSOR_COUNT &&
+         (sensorTopicHash[id] != hash || strcmp(SENSORS[id].topic, topic) != 0)) {
+    id++;
+  }
+  return id;
+}
+
+// Dedup and parse one payload into the pending slot; 'key' is the topic +
+// payload hash. Storing waits for mqttApplyPending.
+static bool applyMessage(AppState& s, uint8_t id, const char* payload, uint32_t key,
+                         bool qos1, bool dup, unsigned long now) {
+  messagesSeen++;
+  if (qos1) {
+    if (dup && isRecentMessage(key, now)) {
+      s.connStats.duplicatesDropped++;
+      return false;
+    }
+    rememberMessage(key, now);
+  }
+
+  int32_t v = 0;
+  const char* end = parseSensorValue(payload, v);
+  if (!end || *end != '\0' || !sensorInRange((SensorId)id, v)) return false;
+  if (pending[id].valid) s.connStats.messagesCoalesced++;
+  pending[id] = {v, true};
+  return true;
+}
 
-  char buf[32];
+static void mqttApplyPending(AppState& s, unsigned long now) {
+  for (uint8_t id = 0; id < SENSOR_COUNT; id++) {
+    if (!pending[id].valid) continue;
+    pending[id].valid = false;
+    sensorApplyMqtt(s, (SensorId)id, pending[id].value, now);
+  }
+}
+
+void mqttPoll(AppState& s, unsigned long now) {
+  unsigned long startUs = micros();
+  uint16_t n = 0;
+  bool more = false;
+  while (true) {
+    unsigned long before = messagesSeen;
+    s.mqttClient.poll();
+    if (messagesSeen == before) break;
+    n += (uint16_t)(messagesSeen - before);
+    if (n >= MQTT_POLL_MAX_MSGS || micros() - startUs >= MQTT_POLL_BUDGET_US) {
+      more = true;
+      break;
+    }
+  }
+  mqttApplyPending(s, now);
+
+  if (n > 0) {
+    pollIntervalMs = MQTT_POLL_INTERVAL_MS;
+  } else if (pollIntervalMs < MQTT_POLL_IDLE_MAX_MS) {
+    pollIntervalMs *= 2;
+    if (pollIntervalMs > MQTT_POLL_IDLE_MAX_MS) pollIntervalMs = MQTT_POLL_IDLE_MAX_MS;
+  }
+  // Out of budget: come straight back on the next pass, after the UI had its turn.
+  unsigned long interval = s.displayOffForSchedule ? MQTT_NIGHT_POLL_MS : pollIntervalMs;
+  schedAt(TASK_MQTT_POLL, more ? now : now + interval);
+}
+
+static bool isScheduleTopic(const char* topic, uint32_t hash) {
+  return TOPIC_SCHEDULE[0] && hash == scheduleTopicHash && strcmp(topic, TOPIC_SCHEDULE) == 0;
+}
+
+static void dispatchSchedule(AppState& s) {
+  messagesSeen++;
+  char text[SCHEDULE_TEXT_MAX];
   size_t n = 0;
-  while (s.mqttClient.available() && n < sizeof(buf) - 1) {
-    buf[n++] = (char)s.mqttClient.read();
+  bool fits = true;
+  while (s.mqttClient.available()) {
+    char c = (char)s.mqttClient.read();
+    if (n < sizeof(text) - 1) text[n++] = c;
+    else fits = false;
   }
-  buf[n] = '\0';
+  text[n] = '\0';
+  // An empty payload only clears the retained message; keep the schedule.
+  if (n == 0) return;
+  bool ok = fits && applyScheduleText(s, text);
+#if SERIAL_DEBUG
+  Serial.println(ok ? "Schedule from MQTT applied" : "Schedule from MQTT rejected");
+#else
+  (void)ok;
+#endif
+}
 
-  while (n && (buf[n-1] == '\r' || buf[n-1] == '\n' || buf[n-1] == ' ' || buf[n-1] == '\t')) {
-    buf[--n] = '\0';
+static void dispatchMessage(AppState& s) {
+  char topic[MQTT_TOPIC_MAX];
+  uint32_t hash = 0;
+  if (!readTopic(s, topic, sizeof(topic), hash)) return;
+  if (isScheduleTopic(topic, hash)) {
+    dispatchSchedule(s);
+    return;
   }
 
-  char* endPtr = nullptr;
-  float v = strtof(buf, &endPtr);
-  if (endPtr == buf) return;
-
-  if (strcmp(topic, TOPIC_TEMP) == 0) {
-    if (s.simTempEnabled) return;
-    if (v < TEMP_MIN_C || v > TEMP_MAX_C) return;
-    bool changed = isnan(s.lastTemp) || fabsf(s.lastTemp - v) >= PERSIST_DELTA;
-    s.lastTemp = v;
-    s.lastTempUpdateMs = millis();
-    if (changed) s.tempUpdatedSincePersist = true;
-  } else if (strcmp(topic, TOPIC_HUM) == 0) {
-    if (s.simHumEnabled) return;
-    if (v < HUM_MIN || v > HUM_MAX) return;
-    bool changed = isnan(s.lastHum) || fabsf(s.lastHum - v) >= PERSIST_DELTA;
-    s.lastHum = v;
-    s.lastHumUpdateMs = millis();
-    if (changed) s.humUpdatedSincePersist = true;
+  uint8_t id = sensorForTopic(topic, hash);
+  if (id == SENSOR_COUNT) return;
+
+  char buf[MQTT_PAYLOAD_MAX];
+  size_t n = 0;
+  uint32_t key = hash;
+  while (s.mqttClient.available() && n < sizeof(buf) - 1) {
+    buf[n] = (char)s.mqttClient.read();
+    key = topicHashStep(key, buf[n++]);
   }
+  buf[n] = '\0';
+
+  applyMessage(s, id, buf, key, s.mqttClient.messageQoS() > 0, s.mqttClient.messageDup(), millis());
+}
+
+void onMqttMessage(int) {
+  if (!gAppState) return;
+  unsigned long startUs = micros();
+  dispatchMessage(*gAppState);
+  perfRecord(PERF_MQTT_MSG, micros() - startUs);
+}
+
+// MQTT_CLIENT_ID plus the last three MAC bytes, so a persistent session
+// belongs to one display and survives reboots.
+static const char* clientId() {
+  static char id[sizeof(MQTT_CLIENT_ID) + 7];
+  if (!MQTT_CLIENT_ID_MAC_SUFFIX) return MQTT_CLIENT_ID;
+  if (id[0]) return id;
+  uint8_t mac[6] = {0};
+  WiFi.macAddress(mac);
+  snprintf(id, sizeof(id), "%s-%02x%02x%02x", MQTT_CLIENT_ID, mac[3], mac[4], mac[5]);
+  return id;
 }
 
 void mqttConfigureOnce(AppState& s) {
-  s.mqttClient.setId(MQTT_CLIENT_ID);
-  s.mqttClient.setCleanSession(true);
+  s.mqttClient.setId(clientId());
+  s.mqttClient.setCleanSession(MQTT_CLEAN_SESSION);
   s.mqttClient.setKeepAliveInterval(30UL * 1000UL);
   s.mqttClient.setConnectionTimeout(MQTT_CONNECT_TIMEOUT_MS);
 #if USE_MQTT_AUTH
@@ -60,9 +232,12 @@ void mqttConfigureOnce(AppState& s) {
 }
 
 bool mqttSubscribeOnce(AppState& s) {
-  bool ok1 = s.mqttClient.subscribe(TOPIC_TEMP, MQTT_SUB_QOS);
-  bool ok2 = s.mqttClient.subscribe(TOPIC_HUM, MQTT_SUB_QOS);
-  return ok1 && ok2;
+  bool ok = true;
+  for (const SensorDef& def : SENSORS) {
+    if (!s.mqttClient.subscribe(def.topic, MQTT_SUB_QOS)) ok = false;
+  }
+  if (TOPIC_SCHEDULE[0] && !s.mqttClient.subscribe(TOPIC_SCHEDULE, MQTT_SUB_QOS)) ok = false;
+  return ok;
 }
 
 void mqttPublishStatusOnline(AppState& s) {
@@ -4,6 +4,10 @@
 
 void mqttBindState(AppState& s);
 void onMqttMessage(int);
+// Polls the client until it is drained or the per-pass budget
+// (MQTT_POLL_MAX_MSGS / MQTT_POLL_BUDGET_US) runs out, then stores the
+// latest reading per sensor.
+void mqttPoll(AppState& s, unsigned long now);
 void mqttConfigureOnce(AppState& s);
 bool mqttSubscribeOnce(AppState& s);
 void mqttPublishStatusOnline(AppState& s);
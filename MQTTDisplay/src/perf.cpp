@@ -0,0 +1,84 @@
+#include "perf.h"
+
+// Bucket b holds samples in [2^(b-1), 2^b) us; bucket 0 is < 1 us and the
+// last bucket collects everything from 2^(PERF_BUCKETS-2) us upwards.
+const uint8_t PERF_BUCKETS = 18;
+
+struct PerfStats {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint32_t hist[PERF_BUCKETS];
+};
+
+static PerfStats perfStats[PERF_PHASE_COUNT];
+
+static const char* const PERF_NAMES[PERF_PHASE_COUNT] = {
+  "serial", "connection", "time", "sim", "schedule", "mqtt_poll", "mqtt_msg",
+  "ui", "wipe", "persist", "render", "loop"
+};
+
+static uint8_t perfBucket(unsigned long us) {
+  uint8_t b = 0;
+  while (us != 0 && b < PERF_BUCKETS - 1) {
+    us >>= 1;
+    b++;
+  }
+  return b;
+}
+
+void perfReset() {
+  for (PerfStats& p : perfStats) {
+    p = PerfStats();
+    p.minUs = UINT32_MAX;
+  }
+}
+
+void perfRecord(PerfPhase phase, unsigned long us) {
+  PerfStats& p = perfStats[phase];
+  p.count++;
+  p.sumUs += us;
+  if (us < p.minUs) p.minUs = us;
+  if (us > p.maxUs) p.maxUs = us;
+  p.hist[perfBucket(us)]++;
+}
+
+void perfLap(PerfPhase phase, unsigned long& markUs) {
+  unsigned long t = micros();
+  perfRecord(phase, t - markUs);
+  markUs = t;
+}
+
+// Upper bound of the bucket holding the 99th percentile sample.
+static unsigned long perfP99(const PerfStats& p) {
+  uint32_t rank = p.count - p.count / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+    seen += p.hist[b];
+    if (seen >= rank) return (b == 0) ? 1UL : (1UL << b);
+  }
+  return p.maxUs;
+}
+
+void perfPrint() {
+  for (uint8_t i = 0; i < PERF_PHASE_COUNT; i++) {
+    const PerfStats& p = perfStats[i];
+    Serial.print("perf ");
+    Serial.print(PERF_NAMES[i]);
+    Serial.print(" n=");
+    Serial.print(p.count);
+    if (p.count == 0) {
+      Serial.println();
+      continue;
+    }
+    Serial.print(" min_us=");
+    Serial.print(p.minUs);
+    Serial.print(" mean_us=");
+    Serial.print((unsigned long)(p.sumUs / p.count));
+    Serial.print(" p99_us<=");
+    Serial.print(perfP99(p));
+    Serial.print(" max_us=");
+    Serial.println(p.maxUs);
+  }
+}
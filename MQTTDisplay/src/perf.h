@@ -0,0 +1,25 @@
+#pragma once
+
+#include "app_state.h"
+
+enum PerfPhase : uint8_t {
+  PERF_SERIAL,
+  PERF_CONNECTION,
+  PERF_TIME,
+  PERF_SIM,
+  PERF_SCHEDULE,
+  PERF_MQTT_POLL,
+  PERF_MQTT_MSG,
+  PERF_UI,
+  PERF_WIPE,
+  PERF_PERSIST,
+  PERF_RENDER,
+  PERF_LOOP,
+  PERF_PHASE_COUNT
+};
+
+void perfReset();
+void perfRecord(PerfPhase phase, unsigned long us);
+// Records the time since mark under phase and moves mark to now.
+void perfLap(PerfPhase phase, unsigned long& markUs);
+void perfPrint();
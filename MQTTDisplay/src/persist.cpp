@@ -1,5 +1,35 @@
 #include "persist.h"
+#include "scheduler.h"
+#include "settings.h"
+#include "crc32.h"
 
+// EEPROM map:
+//   0     legacy sensor record (read once for migration)
+//   64    legacy settings record (v1); shares space with the ezTime cache
+//   PERSIST_JOURNAL_ADDR .. + PERSIST_JOURNAL_SLOTS * sizeof(SensorRecord)
+//   1664  settings slot A, 1728 settings slot B
+//   1792  schedule slot A, 2048 schedule slot B
+
+const uint32_t PERSIST_MAGIC = 0x54484D44; // "THMD"
+const int SENSOR_PERSIST_ADDR = 0;
+const int SETTINGS_V1_ADDR = 64;
+const int SETTINGS_PERSIST_ADDR = 1664;
+const int SETTINGS_PERSIST_ADDR_B = 1728;
+const uint32_t SETTINGS_MAGIC = 0x54485354; // "THST"
+const int SCHEDULE_PERSIST_ADDR = 1792;
+const int SCHEDULE_PERSIST_ADDR_B = 2048;
+const uint32_t SCHEDULE_MAGIC = 0x54485343; // "THSC"
+
+// Record versions written by this firmware. Older versions are migrated on load.
+const uint16_t SETTINGS_VERSION = 2;
+const uint16_t SENSOR_RECORD_VERSION = 3;
+const uint16_t SCHEDULE_VERSION = 2;
+
+// Room for the planned CO2, pressure and power sensors and a few more.
+const uint8_t PERSIST_MAX_SENSORS = 8;
+static_assert(SENSOR_COUNT <= PERSIST_MAX_SENSORS, "sensor journal record too small");
+
+// Pre-journal sensor record.
 struct PersistedData {
   uint32_t magic;
   float temp;
@@ -7,12 +37,19 @@ struct PersistedData {
   uint16_t checksum;
 };
 
-const uint32_t PERSIST_MAGIC = 0x54484D44; // "THMD"
-const int SENSOR_PERSIST_ADDR = 0;
-const int SETTINGS_PERSIST_ADDR = 64;
-const uint32_t SETTINGS_MAGIC = 0x54485354; // "THST"
-const uint16_t SETTINGS_VERSION = 1;
+// One slot of the sensor journal. The newest valid slot (highest seq) wins.
+// values[] holds fixed-point sensor values (see SENSOR_SCALE) since version
+// 3 and floats in version 2 records, which share the layout.
+struct SensorRecord {
+  uint32_t seq;
+  uint16_t version;
+  uint8_t count;
+  uint8_t reserved;
+  int32_t values[PERSIST_MAX_SENSORS];
+  uint32_t crc;
+};
 
+// Pre-journal settings record.
 struct PersistedSettings {
   uint32_t magic;
   uint16_t version;
@@ -22,82 +59,356 @@ struct PersistedSettings {
   uint16_t checksum;
 };
 
+// values[i] belongs to SETTINGS[i]; a record of version v holds every
+// setting whose sinceVersion is <= v.
+struct SettingsRecord {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t generation;
+  uint32_t values[SETTINGS_MAX_FIELDS];
+  uint32_t crc;
+};
+
+// Weekly schedule; A/B slots like the settings.
+struct ScheduleRecord {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t generation;
+  uint8_t count;
+  uint8_t reserved[3];
+  ScheduleInterval intervals[SCHEDULE_MAX_INTERVALS];
+  uint32_t crc;
+};
+
+// A record staged in RAM and written a few bytes per loop pass. The first
+// markerLen bytes (sequence number or magic) are written last, so a reset
+// mid-write leaves a record that fails validation and the previous one wins.
+const uint8_t PERSIST_JOB_MAX = 208;
+
+struct PersistJob {
+  bool active;
+  int addr;
+  uint8_t len;
+  uint8_t markerLen;
+  uint8_t pos;
+  uint8_t buf[PERSIST_JOB_MAX];
+};
+
+enum PersistJobId : uint8_t { JOB_SENSOR, JOB_SETTINGS, JOB_SCHEDULE, JOB_COUNT };
+
+static PersistJob persistJobs[JOB_COUNT];
+static_assert(sizeof(SensorRecord) <= PERSIST_JOB_MAX, "sensor record exceeds job buffer");
+static_assert(sizeof(SettingsRecord) <= PERSIST_JOB_MAX, "settings record exceeds job buffer");
+static_assert(sizeof(ScheduleRecord) <= PERSIST_JOB_MAX, "schedule record exceeds job buffer");
+static_assert(SCHEDULE_PERSIST_ADDR + (int)sizeof(ScheduleRecord) <= SCHEDULE_PERSIST_ADDR_B,
+              "schedule slots overlap");
+static_assert(PERSIST_JOURNAL_ADDR + PERSIST_JOURNAL_SLOTS * (int)sizeof(SensorRecord) <= SETTINGS_PERSIST_ADDR,
+              "sensor journal overlaps the settings slots");
+
+static uint8_t journalSlot = 0;  // slot holding the newest record
+static uint32_t journalSeq = 0;  // its sequence number, 0 while the journal is empty
+static bool settingsOnB = false; // slot holding the newest settings
+static uint16_t settingsGeneration = 0;
+static bool scheduleOnB = false;
+static uint16_t scheduleGeneration = 0;
+
 static uint16_t checksum16(const uint8_t* data, size_t len) {
   uint16_t sum = 0;
   for (size_t i = 0; i < len; i++) sum = (uint16_t)(sum + data[i]);
   return sum;
 }
 
-void loadPersisted(AppState& s) {
+static void stageJob(PersistJobId id, int addr, const void* data, uint8_t len, uint8_t markerLen) {
+  PersistJob& job = persistJobs[id];
+  memcpy(job.buf, data, len);
+  job.addr = addr;
+  job.len = len;
+  job.markerLen = markerLen;
+  job.pos = 0;
+  job.active = true;
+}
+
+static void finishJob(PersistJobId id) {
+  persistJobs[id].active = false;
+  if (id == JOB_SENSOR) {
+    uint32_t seq;
+    memcpy(&seq, persistJobs[id].buf, sizeof(seq));
+    journalSlot = (uint8_t)((journalSlot + 1) % PERSIST_JOURNAL_SLOTS);
+    journalSeq = seq;
+  }
+}
+
+// Writes up to maxBytes of staged data; returns true while work remains.
+static bool stepJobs(uint16_t maxBytes) {
+  for (uint8_t id = 0; id < JOB_COUNT; id++) {
+    PersistJob& job = persistJobs[id];
+    while (job.active && maxBytes > 0) {
+      uint8_t i = (uint8_t)((job.pos + job.markerLen) % job.len);
+      EEPROM.update(job.addr + i, job.buf[i]);
+      maxBytes--;
+      if (++job.pos >= job.len) finishJob((PersistJobId)id);
+    }
+    if (job.active) return true;
+  }
+  return false;
+}
+
+void persistFlush() {
+  while (stepJobs(UINT16_MAX)) {}
+}
+
+static void eraseRange(int addr, int len) {
+  for (int i = 0; i < len; i++) EEPROM.update(addr + i, 0);
+}
+
+static int journalAddr(uint8_t slot) {
+  return PERSIST_JOURNAL_ADDR + slot * (int)sizeof(SensorRecord);
+}
+
+static int32_t floatToSensorValue(float v) {
+  if (isnan(v) || fabsf(v) > 2.0e7f) return SENSOR_NO_VALUE;
+  return (int32_t)lroundf(v * SENSOR_SCALE);
+}
+
+// Brings a journal record up to SENSOR_RECORD_VERSION; false for versions
+// this firmware does not know, including ones written by newer firmware.
+static bool migrateSensorRecord(SensorRecord& rec) {
+  switch (rec.version) {
+    case SENSOR_RECORD_VERSION:
+      return true;
+    case 2:
+      for (uint8_t i = 0; i < rec.count; i++) {
+        float f;
+        memcpy(&f, &rec.values[i], sizeof(f));
+        rec.values[i] = floatToSensorValue(f);
+      }
+      rec.version = SENSOR_RECORD_VERSION;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool readJournalSlot(uint8_t slot, SensorRecord& rec) {
+  EEPROM.get(journalAddr(slot), rec);
+  return rec.seq != 0 && rec.count <= PERSIST_MAX_SENSORS &&
+         crc32(&rec, offsetof(SensorRecord, crc)) == rec.crc &&
+         migrateSensorRecord(rec);
+}
+
+static bool loadLegacySensorRecord(float& temp, float& hum) {
   PersistedData data = {};
   EEPROM.get(SENSOR_PERSIST_ADDR, data);
 
-  size_t len = sizeof(PersistedData) - sizeof(uint16_t);
+  size_t len = offsetof(PersistedData, checksum);
   uint16_t cs = checksum16((const uint8_t*)&data, len);
+  if (data.magic != PERSIST_MAGIC || cs != data.checksum) return false;
+
+  temp = data.temp;
+  hum = data.hum;
+  return true;
+}
+
+void loadPersisted(AppState& s) {
+  journalSlot = PERSIST_JOURNAL_SLOTS - 1;
+  journalSeq = 0;
+
+  SensorRecord newest = {};
+  for (uint8_t slot = 0; slot < PERSIST_JOURNAL_SLOTS; slot++) {
+    SensorRecord rec;
+    if (!readJournalSlot(slot, rec) || rec.seq <= journalSeq) continue;
+    newest = rec;
+    journalSeq = rec.seq;
+    journalSlot = slot;
+  }
 
-  if (data.magic == PERSIST_MAGIC && cs == data.checksum) {
-    s.lastTemp = data.temp;
-    s.lastHum = data.hum;
-    unsigned long now = millis();
-    s.lastTempUpdateMs = now;
-    s.lastHumUpdateMs = now;
+  if (journalSeq == 0) {
+    // The pre-journal record only knows temperature and humidity.
+    float temp = NAN;
+    float hum = NAN;
+    if (!loadLegacySensorRecord(temp, hum)) return;
+    newest.count = 2;
+    newest.values[SENSOR_TEMP] = floatToSensorValue(temp);
+    newest.values[SENSOR_HUM] = floatToSensorValue(hum);
   }
+
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < newest.count && i < SENSOR_COUNT; i++) {
+    // A sensor that had not reported yet stays stale after the restore.
+    if (newest.values[i] == SENSOR_NO_VALUE) continue;
+    s.sensors[i].value = newest.values[i];
+    s.sensors[i].updateMs = now;
+  }
+
+#if SERIAL_DEBUG
+  Serial.print("Persist journal slot=");
+  Serial.print(journalSlot);
+  Serial.print(" seq=");
+  Serial.println(journalSeq);
+#endif
 }
 
 void maybePersist(AppState& s, unsigned long now) {
-  if (!s.tempUpdatedSincePersist && !s.humUpdatedSincePersist) return;
-  if (now - s.lastPersistMs < PERSIST_MIN_INTERVAL_MS) return;
+  if (stepJobs(PERSIST_BYTES_PER_TICK)) {
+    schedAt(TASK_PERSIST, now);
+    return;
+  }
 
-  PersistedData data = {};
-  data.magic = PERSIST_MAGIC;
-  data.temp = s.lastTemp;
-  data.hum = s.lastHum;
+  bool dirty = false;
+  for (const SensorState& st : s.sensors) dirty |= st.updatedSincePersist;
+  if (!dirty) return;
+  if (now - s.lastPersistMs < PERSIST_MIN_INTERVAL_MS) {
+    schedAt(TASK_PERSIST, s.lastPersistMs + PERSIST_MIN_INTERVAL_MS);
+    return;
+  }
 
-  size_t len = sizeof(PersistedData) - sizeof(uint16_t);
-  data.checksum = checksum16((const uint8_t*)&data, len);
+  SensorRecord rec = {};
+  rec.seq = journalSeq + 1;
+  rec.version = SENSOR_RECORD_VERSION;
+  rec.count = SENSOR_COUNT;
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) rec.values[i] = s.sensors[i].value;
+  rec.crc = crc32(&rec, offsetof(SensorRecord, crc));
 
-  EEPROM.put(SENSOR_PERSIST_ADDR, data);
+  uint8_t slot = (uint8_t)((journalSlot + 1) % PERSIST_JOURNAL_SLOTS);
+  stageJob(JOB_SENSOR, journalAddr(slot), &rec, sizeof(rec), sizeof(rec.seq));
+  schedAt(TASK_PERSIST, now);
   s.lastPersistMs = now;
-  s.tempUpdatedSincePersist = false;
-  s.humUpdatedSincePersist = false;
+  for (SensorState& st : s.sensors) st.updatedSincePersist = false;
 }
 
-bool loadRuntimeSettings(AppState& s) {
-  PersistedSettings data = {};
-  EEPROM.get(SETTINGS_PERSIST_ADDR, data);
+static bool readSettingsSlot(int addr, SettingsRecord& rec) {
+  EEPROM.get(addr, rec);
+  return rec.magic == SETTINGS_MAGIC && rec.version != 0 &&
+         crc32(&rec, offsetof(SettingsRecord, crc)) == rec.crc;
+}
 
-  size_t len = sizeof(PersistedSettings) - sizeof(uint16_t);
+static bool readSettingsV1(PersistedSettings& data) {
+  EEPROM.get(SETTINGS_V1_ADDR, data);
+
+  size_t len = offsetof(PersistedSettings, checksum);
   uint16_t cs = checksum16((const uint8_t*)&data, len);
+  return data.magic == SETTINGS_MAGIC && data.version == 1 && cs == data.checksum;
+}
 
-  if (data.magic != SETTINGS_MAGIC || data.version != SETTINGS_VERSION || cs != data.checksum) {
-    return false;
-  }
+// Picks the newer valid slot of an A/B pair; false if neither is valid.
+template <typename T>
+static bool pickNewer(bool okA, const T& a, bool okB, const T& b, bool& useB) {
+  if (!okA && !okB) return false;
+  useB = okB && (!okA || (int16_t)(b.generation - a.generation) > 0);
+  return true;
+}
 
-  if (data.showMs >= 500 && data.showMs <= 120000) {
-    s.showMs = data.showMs;
+static void applySettingsRecord(AppState& s, const SettingsRecord& rec) {
+  for (uint8_t i = 0; i < SETTINGS_COUNT; i++) {
+    // Settings added after this record was written keep their current value.
+    if (SETTINGS[i].sinceVersion > rec.version) continue;
+    applySetting(s, SETTINGS[i], rec.values[i]);
   }
-  if (data.uiTickMs >= 16 && data.uiTickMs <= 2000) {
-    s.uiTickMs = data.uiTickMs;
+}
+
+static bool loadSettingsV1(AppState& s) {
+  PersistedSettings data = {};
+  if (!readSettingsV1(data)) return false;
+
+  applySetting(s, *findSetting("show_ms"), data.showMs);
+  applySetting(s, *findSetting("ui_tick_ms"), data.uiTickMs);
+  return true;
+}
+
+bool loadRuntimeSettings(AppState& s) {
+  persistFlush();
+
+  SettingsRecord a = {};
+  SettingsRecord b = {};
+  bool okA = readSettingsSlot(SETTINGS_PERSIST_ADDR, a);
+  bool okB = readSettingsSlot(SETTINGS_PERSIST_ADDR_B, b);
+  if (pickNewer(okA, a, okB, b, settingsOnB)) {
+    const SettingsRecord& rec = settingsOnB ? b : a;
+    settingsGeneration = rec.generation;
+    applySettingsRecord(s, rec);
+    return true;
   }
+
+  if (!loadSettingsV1(s)) return false;
+
+  // Rewrite migrated settings in the current format.
+  saveRuntimeSettings(s);
+#if SERIAL_DEBUG
+  Serial.println("Settings migrated from v1");
+#endif
   return true;
 }
 
 void saveRuntimeSettings(const AppState& s) {
-  PersistedSettings data = {};
-  data.magic = SETTINGS_MAGIC;
-  data.version = SETTINGS_VERSION;
-  data.showMs = s.showMs;
-  data.uiTickMs = s.uiTickMs;
+  SettingsRecord rec = {};
+  rec.magic = SETTINGS_MAGIC;
+  rec.version = SETTINGS_VERSION;
+  rec.generation = (uint16_t)(settingsGeneration + 1);
+  for (uint8_t i = 0; i < SETTINGS_COUNT; i++) {
+    rec.values[i] = (uint32_t)(s.*SETTINGS[i].field);
+  }
+  rec.crc = crc32(&rec, offsetof(SettingsRecord, crc));
+
+  // Overwrite the older slot so the current record stays valid until the new one is complete.
+  // A save still in flight has not become current yet, so restage it in place.
+  if (!persistJobs[JOB_SETTINGS].active) settingsOnB = !settingsOnB;
+  settingsGeneration = rec.generation;
+  stageJob(JOB_SETTINGS, settingsOnB ? SETTINGS_PERSIST_ADDR_B : SETTINGS_PERSIST_ADDR,
+           &rec, sizeof(rec), sizeof(rec.magic));
+}
 
-  size_t len = sizeof(PersistedSettings) - sizeof(uint16_t);
-  data.checksum = checksum16((const uint8_t*)&data, len);
+static bool readScheduleSlot(int addr, ScheduleRecord& rec) {
+  EEPROM.get(addr, rec);
+  return rec.magic == SCHEDULE_MAGIC && rec.version == SCHEDULE_VERSION &&
+         rec.count <= SCHEDULE_MAX_INTERVALS &&
+         crc32(&rec, offsetof(ScheduleRecord, crc)) == rec.crc;
+}
+
+bool loadSchedule(AppState& s) {
+  ScheduleRecord a = {};
+  ScheduleRecord b = {};
+  bool okA = readScheduleSlot(SCHEDULE_PERSIST_ADDR, a);
+  bool okB = readScheduleSlot(SCHEDULE_PERSIST_ADDR_B, b);
+  if (!pickNewer(okA, a, okB, b, scheduleOnB)) return false;
 
-  EEPROM.put(SETTINGS_PERSIST_ADDR, data);
+  const ScheduleRecord& rec = scheduleOnB ? b : a;
+  scheduleGeneration = rec.generation;
+  s.schedule = Schedule();
+  s.schedule.count = rec.count;
+  memcpy(s.schedule.intervals, rec.intervals, sizeof(rec.intervals));
+  return true;
+}
+
+void saveSchedule(const AppState& s) {
+  ScheduleRecord rec = {};
+  rec.magic = SCHEDULE_MAGIC;
+  rec.version = SCHEDULE_VERSION;
+  rec.generation = (uint16_t)(scheduleGeneration + 1);
+  rec.count = s.schedule.count;
+  memcpy(rec.intervals, s.schedule.intervals, sizeof(rec.intervals));
+  rec.crc = crc32(&rec, offsetof(ScheduleRecord, crc));
+
+  if (!persistJobs[JOB_SCHEDULE].active) scheduleOnB = !scheduleOnB;
+  scheduleGeneration = rec.generation;
+  stageJob(JOB_SCHEDULE, scheduleOnB ? SCHEDULE_PERSIST_ADDR_B : SCHEDULE_PERSIST_ADDR,
+           &rec, sizeof(rec), sizeof(rec.magic));
 }
 
 void factoryResetPersisted() {
-  PersistedData sensor = {};
-  PersistedSettings settings = {};
-  EEPROM.put(SENSOR_PERSIST_ADDR, sensor);
-  EEPROM.put(SETTINGS_PERSIST_ADDR, settings);
+  for (PersistJob& job : persistJobs) job.active = false;
+
+  eraseRange(SENSOR_PERSIST_ADDR, sizeof(PersistedData));
+  eraseRange(SETTINGS_V1_ADDR, sizeof(PersistedSettings));
+  eraseRange(SETTINGS_PERSIST_ADDR, sizeof(SettingsRecord));
+  eraseRange(SETTINGS_PERSIST_ADDR_B, sizeof(SettingsRecord));
+  eraseRange(SCHEDULE_PERSIST_ADDR, sizeof(ScheduleRecord));
+  eraseRange(SCHEDULE_PERSIST_ADDR_B, sizeof(ScheduleRecord));
+  eraseRange(PERSIST_JOURNAL_ADDR, PERSIST_JOURNAL_SLOTS * (int)sizeof(SensorRecord));
+
+  settingsOnB = false;
+  settingsGeneration = 0;
+  scheduleOnB = false;
+  scheduleGeneration = 0;
+  journalSlot = PERSIST_JOURNAL_SLOTS - 1;
+  journalSeq = 0;
 }
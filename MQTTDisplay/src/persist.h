@@ -6,4 +6,7 @@ void loadPersisted(AppState& s);
 void maybePersist(AppState& s, unsigned long now);
 bool loadRuntimeSettings(AppState& s);
 void saveRuntimeSettings(const AppState& s);
+bool loadSchedule(AppState& s);
+void saveSchedule(const AppState& s);
+void persistFlush();
 void factoryResetPersisted();
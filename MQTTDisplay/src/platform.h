@@ -0,0 +1,28 @@
+#pragma once
+
+// Every board library the firmware uses is included here and nowhere else.
+// An off-board build only has to put headers with these names on the
+// include path (and skip the WDT/pgmspace ones) to compile the sketch.
+
+#include <Arduino.h>
+#include <math.h>
+#include <WiFiS3.h>
+#include <WiFiUdp.h>
+#include <ArduinoMqttClient.h>
+#include <Arduino_LED_Matrix.h>
+#include <EEPROM.h>
+#include <ezTime.h>
+
+#if __has_include(<WDT.h>)
+#include <WDT.h>
+#define HAS_WDT 1
+#else
+#define HAS_WDT 0
+#endif
+
+#if __has_include(<pgmspace.h>)
+#include <pgmspace.h>
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
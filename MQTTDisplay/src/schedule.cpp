@@ -1,35 +1,319 @@
 #include "schedule.h"
 #include "time_service.h"
 #include "matrix_io.h"
+#include "scheduler.h"
+#include "persist.h"
+#include "ui.h"
 
-bool shouldDisplayBeOffNow(const AppState& s) {
-#if defined(FORCE_NIGHT_OFF)
-  return true;
-#elif defined(FORCE_DAY_ON)
+const uint16_t DAY_MINUTES = 24 * 60;
+static const char* const DAY_NAMES[7] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+static const char* skipSpaces(const char* p) {
+  while (*p == ' ' || *p == '\t') p++;
+  return p;
+}
+
+// Copies the next word (up to a space, ',', ';' or '-') into out.
+static const char* readWord(const char* p, char* out, size_t cap) {
+  size_t n = 0;
+  while (*p && *p != ' ' && *p != '\t' && *p != ',' && *p != ';' && *p != '-') {
+    if (n + 1 < cap) out[n++] = *p;
+    p++;
+  }
+  out[n] = '\0';
+  return p;
+}
+
+static bool parseDay(const char*& p, uint8_t& day) {
+  char word[8];
+  p = readWord(p, word, sizeof(word));
+  for (uint8_t d = 0; d < 7; d++) {
+    if (strcmp(word, DAY_NAMES[d]) == 0) {
+      day = d;
+      return true;
+    }
+  }
   return false;
-#endif
+}
+
+static bool parseDays(const char*& p, uint8_t& mask) {
+  if (strncmp(p, "all", 3) == 0 && (p[3] == ' ' || p[3] == '\t')) {
+    p += 3;
+    mask = 0x7F;
+    return true;
+  }
+  mask = 0;
+  while (true) {
+    uint8_t first = 0;
+    if (!parseDay(p, first)) return false;
+    uint8_t last = first;
+    if (*p == '-') {
+      p++;
+      if (!parseDay(p, last)) return false;
+    }
+    // Ranges may wrap (fri-mon).
+    for (uint8_t d = first;; d = (uint8_t)((d + 1) % 7)) {
+      mask |= (uint8_t)(1u << d);
+      if (d == last) break;
+    }
+    if (*p != ',') return true;
+    p++;
+  }
+}
 
-  if (!timeIsValid(s)) return false;
+// H:MM or HH:MM; 24:00 is accepted as an end time.
+static bool parseClock(const char*& p, uint16_t& minutes) {
+  if (*p < '0' || *p > '9') return false;
+  uint16_t h = 0;
+  while (*p >= '0' && *p <= '9') h = (uint16_t)(h * 10 + (*p++ - '0'));
+  if (*p++ != ':') return false;
+  if (p[0] < '0' || p[0] > '5' || p[1] < '0' || p[1] > '9') return false;
+  uint16_t m = (uint16_t)((p[0] - '0') * 10 + (p[1] - '0'));
+  p += 2;
+  if (h > 24 || (h == 24 && m != 0)) return false;
+  minutes = (uint16_t)(h * 60 + m);
+  return true;
+}
+
+static bool parseScreens(const char*& p, ScreenMask& mask) {
+  mask = 0;
+  while (true) {
+    char word[24];
+    p = readWord(p, word, sizeof(word));
+    ScreenMode mode = 0;
+    if (!parseScreenName(word, mode)) return false;
+    mask |= (ScreenMask)1 << mode;
+    if (*p != ',') return true;
+    p++;
+  }
+}
 
-  int hh = berlinHour();
-  int dow = berlinWeekday0(); // 0=Sun..6=Sat
+static bool parseActions(const char*& p, uint8_t& brightness, ScreenMask& screens) {
+  brightness = 100;
+  screens = 0;
+  bool any = false;
+  while (true) {
+    p = skipSpaces(p);
+    if (*p == '\0' || *p == ';') return any;
+    char word[8];
+    p = readWord(p, word, sizeof(word));
+    if (strcmp(word, "off") == 0) {
+      brightness = 0;
+    } else if (strcmp(word, "dim") == 0) {
+      p = skipSpaces(p);
+      char* end = nullptr;
+      long v = strtol(p, &end, 10);
+      if (end == p || v < 1 || v > 100) return false;
+      brightness = (uint8_t)v;
+      p = end;
+    } else if (strcmp(word, "show") == 0) {
+      p = skipSpaces(p);
+      if (!parseScreens(p, screens)) return false;
+    } else {
+      return false;
+    }
+    any = true;
+  }
+}
 
-  if (hh < 8) return true;
-  // Off from 22:00–24:00 on Sun–Thu (stay on later Fri–Sat)
-  if (dow <= 4 && hh >= 22) return true;
+static bool parseEntry(const char*& p, Schedule& out) {
+  uint8_t days = 0;
+  uint16_t from = 0;
+  uint16_t to = 0;
+  uint8_t brightness = 100;
+  ScreenMask screens = 0;
+  if (!parseDays(p, days)) return false;
+  p = skipSpaces(p);
+  if (!parseClock(p, from) || *p++ != '-' || !parseClock(p, to)) return false;
+  if (from == to || from >= DAY_MINUTES) return false;
+  if (!parseActions(p, brightness, screens)) return false;
 
-  return false;
+  if (out.count >= SCHEDULE_MAX_INTERVALS) return false;
+  ScheduleInterval& iv = out.intervals[out.count++];
+  iv.start = from;
+  iv.end = to == 0 ? DAY_MINUTES : to;
+  iv.days = days;
+  iv.brightness = brightness;
+  iv.screens = screens;
+  return true;
+}
+
+bool parseSchedule(const char* text, Schedule& out) {
+  out = Schedule();
+  const char* p = skipSpaces(text);
+  while (*p) {
+    if (!parseEntry(p, out)) return false;
+    p = skipSpaces(p);
+    if (*p == ';') p = skipSpaces(p + 1);
+    else if (*p) return false;
+  }
+  return true;
+}
+
+static void printClock(uint16_t minutes) {
+  uint16_t h = minutes / 60;
+  uint16_t m = minutes % 60;
+  if (h < 10) Serial.print("0");
+  Serial.print(h);
+  Serial.print(":");
+  if (m < 10) Serial.print("0");
+  Serial.print(m);
 }
 
-void applyDisplayOffIfNeeded(AppState& s, bool off) {
-  if (off == s.displayOffForSchedule) return;
-  s.displayOffForSchedule = off;
+// Prints a day mask as "all" or runs such as "sun-thu,sat".
+static void printDays(uint8_t days) {
+  if (days == 0x7F) {
+    Serial.print("all");
+    return;
+  }
+  bool first = true;
+  for (uint8_t d = 0; d < 7; d++) {
+    if (!(days & (1u << d))) continue;
+    uint8_t last = d;
+    while (last + 1 < 7 && (days & (1u << (last + 1)))) last++;
+    if (!first) Serial.print(",");
+    Serial.print(DAY_NAMES[d]);
+    if (last != d) {
+      Serial.print("-");
+      Serial.print(DAY_NAMES[last]);
+    }
+    first = false;
+    d = last;
+  }
+}
+
+void printSchedule(const Schedule& sc) {
+  if (sc.count == 0) {
+    Serial.println("schedule empty");
+    return;
+  }
+  for (uint8_t i = 0; i < sc.count; i++) {
+    const ScheduleInterval& iv = sc.intervals[i];
+    Serial.print("schedule ");
+    printDays(iv.days);
+    Serial.print(" ");
+    printClock(iv.start);
+    Serial.print("-");
+    printClock(iv.end);
+    if (iv.brightness == 0) Serial.print(" off");
+    else if (iv.brightness < 100) {
+      Serial.print(" dim ");
+      Serial.print(iv.brightness);
+    }
+    if (iv.screens) {
+      Serial.print(" show ");
+      bool first = true;
+      for (ScreenMode m = 0; m < SCREEN_COUNT; m++) {
+        if (!(iv.screens & ((ScreenMask)1 << m))) continue;
+        if (!first) Serial.print(",");
+        printScreenName(m);
+        first = false;
+      }
+    }
+    Serial.println();
+  }
+}
+
+void scheduleReset(Schedule& sc) {
+  if (!parseSchedule(SCHEDULE_DEFAULT, sc)) sc = Schedule();
+}
+
+void scheduleChanged(AppState& s) {
+  s.scheduleNextS = 0;
+  s.scheduleEvalS = 0;
+}
+
+bool applyScheduleText(AppState& s, const char* text) {
+  Schedule next;
+  if (!parseSchedule(text, next)) return false;
+  // A retained schedule arrives again on every reconnect; only save changes.
+  if (next.count == s.schedule.count &&
+      memcmp(next.intervals, s.schedule.intervals, next.count * sizeof(ScheduleInterval)) == 0) {
+    return true;
+  }
+  s.schedule = next;
+  saveSchedule(s);
+  scheduleChanged(s);
+  return true;
+}
+
+// w is the week minute (Sunday 00:00 = 0).
+static bool inInterval(const ScheduleInterval& iv, uint16_t w) {
+  uint8_t day = (uint8_t)(w / DAY_MINUTES);
+  uint16_t m = (uint16_t)(w % DAY_MINUTES);
+  bool today = iv.days & (1u << day);
+  if (iv.start < iv.end) return today && m >= iv.start && m < iv.end;
+  // Overnight: the evening part today, or the morning part of yesterday's run.
+  bool yesterday = iv.days & (1u << ((day + 6) % 7));
+  return (today && m >= iv.start) || (yesterday && m < iv.end);
+}
+
+// Minutes from w to the nearest interval boundary after it.
+static uint16_t minutesToNextBoundary(const Schedule& sc, uint16_t w) {
+  uint16_t best = WEEK_MINUTES;
+  for (uint8_t i = 0; i < sc.count; i++) {
+    const ScheduleInterval& iv = sc.intervals[i];
+    uint16_t span = iv.start < iv.end ? iv.end - iv.start : DAY_MINUTES - iv.start + iv.end;
+    for (uint8_t d = 0; d < 7; d++) {
+      if (!(iv.days & (1u << d))) continue;
+      uint16_t start = (uint16_t)(d * DAY_MINUTES + iv.start);
+      uint16_t end = (uint16_t)((start + span) % WEEK_MINUTES);
+      uint16_t toStart = (uint16_t)((start + WEEK_MINUTES - w) % WEEK_MINUTES);
+      uint16_t toEnd = (uint16_t)((end + WEEK_MINUTES - w) % WEEK_MINUTES);
+      if (toStart != 0 && toStart < best) best = toStart;
+      if (toEnd != 0 && toEnd < best) best = toEnd;
+    }
+  }
+  return best;
+}
+
+static void applyInterval(AppState& s, int8_t index, unsigned long now) {
+  s.scheduleActive = index;
+  const ScheduleInterval* iv = index >= 0 ? &s.schedule.intervals[index] : nullptr;
+  s.displayOffForSchedule = iv && iv->brightness == 0;
+  s.brightness = iv ? iv->brightness : 100;
+  s.screenMask = iv ? iv->screens : 0;
+  // Leave a screen the new interval does not show at the next loop pass.
+  if (s.screenMask && !(s.screenMask & ((ScreenMask)1 << s.mode))) s.screenStartMs = now - s.showMs;
+}
+
+void scheduleTick(AppState& s, bool enabled, unsigned long now) {
+  if (!enabled || !timeIsValid(s)) {
+    if (s.scheduleActive >= 0 || s.displayOffForSchedule) applyInterval(s, -1, now);
+    scheduleChanged(s);
+    return;
+  }
+
+#if defined(FORCE_NIGHT_OFF)
+  s.displayOffForSchedule = true;
+  return;
+#elif defined(FORCE_DAY_ON)
+  s.displayOffForSchedule = false;
+  return;
+#endif
+
+  // Also re-evaluate when the clock went back (DST end, SNTP step).
+  time_t local = berlinNow().localSeconds;
+  if (local < s.scheduleNextS && local >= s.scheduleEvalS) return;
+
+  uint16_t w = (uint16_t)(berlinNow().weekday0 * DAY_MINUTES + (local % 86400L) / 60);
+  int8_t active = -1;
+  for (uint8_t i = 0; i < s.schedule.count; i++) {
+    if (inInterval(s.schedule.intervals[i], w)) {
+      active = (int8_t)i;
+      break;
+    }
+  }
+  if (active != s.scheduleActive || s.scheduleEvalS == 0) applyInterval(s, active, now);
+
+  s.scheduleEvalS = local;
+  s.scheduleNextS = local - local % 60 + (time_t)minutesToNextBoundary(s.schedule, w) * 60;
 }
 
 void nightLedMinuteBlink(AppState& s, unsigned long now) {
   if (!(timeIsValid(s) && s.displayOffForSchedule)) return;
 
-  int mm = berlinMinute();
+  int mm = berlinNow().minute;
 
   if (mm != s.lastBlinkMinute) {
     s.lastBlinkMinute = mm;
@@ -41,4 +325,6 @@ void nightLedMinuteBlink(AppState& s, unsigned long now) {
     s.ledPulseUntilMs = 0;
     digitalWrite(LED_BUILTIN, LOW);
   }
+  if (s.ledPulseUntilMs != 0) schedAt(TASK_LED, s.ledPulseUntilMs);
+  else schedAt(TASK_LED, now + msToNextMinute(now));
 }
@@ -2,6 +2,24 @@
 
 #include "app_state.h"
 
-bool shouldDisplayBeOffNow(const AppState& s);
-void applyDisplayOffIfNeeded(AppState& s, bool off);
+// Longest schedule text accepted over serial or MQTT.
+const size_t SCHEDULE_TEXT_MAX = 192;
+
+// Schedule text is a ';'-separated list of "<days> <HH:MM>-<HH:MM> <action>"
+// entries. Days are sun..sat, ranges (sun-thu), lists (fri,sat) or "all";
+// an end at or before the start runs into the next day. Actions: "off",
+// "dim <1..100>", "show <screen>[,<screen>...]" (dim and show combine).
+// The first matching entry wins.
+bool parseSchedule(const char* text, Schedule& out);
+void printSchedule(const Schedule& sc);
+void scheduleReset(Schedule& sc);
+// Parses and, if it differs from the current one, applies and saves a new
+// schedule. False on a syntax error.
+bool applyScheduleText(AppState& s, const char* text);
+// Forces the next scheduleTick to re-evaluate.
+void scheduleChanged(AppState& s);
+
+// Updates displayOffForSchedule, brightness and screenMask. Only re-derives
+// the active interval when the precomputed next transition is reached.
+void scheduleTick(AppState& s, bool enabled, unsigned long now);
 void nightLedMinuteBlink(AppState& s, unsigned long now);
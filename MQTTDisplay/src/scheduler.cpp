@@ -0,0 +1,86 @@
+#include "scheduler.h"
+
+static unsigned long schedDueMs[TASK_COUNT];
+static uint16_t schedArmed = 0;
+
+const unsigned long SCHED_AWAKE_WINDOW_US = 60UL * 1000000UL;
+static unsigned long windowStartUs = 0;
+static unsigned long windowSleptUs = 0;
+static uint8_t windowAwakePct = 100;
+static uint64_t bootSleptUs = 0;
+// micros() wraps every ~71 minutes and millis() every ~49.7 days, so uptime
+// is accumulated from short unsigned deltas instead of read off either.
+static uint64_t bootUpUs = 0;
+static unsigned long uptimeLastUs = 0;
+
+static void accumulateUptime() {
+  unsigned long t = micros();
+  bootUpUs += t - uptimeLastUs;
+  uptimeLastUs = t;
+}
+
+void schedBeginPass() {
+  schedArmed = 0;
+  accumulateUptime();
+}
+
+void schedAt(SchedTask task, unsigned long dueMs) {
+  uint16_t bit = (uint16_t)(1u << task);
+  // Several callers may share a task within one pass; the earliest wins.
+  if ((schedArmed & bit) && (long)(dueMs - schedDueMs[task]) >= 0) return;
+  schedDueMs[task] = dueMs;
+  schedArmed |= bit;
+}
+
+bool schedNextDue(unsigned long now, unsigned long& dueMs) {
+  bool any = false;
+  long best = 0;
+  for (uint8_t t = 0; t < TASK_COUNT; t++) {
+    if (!(schedArmed & (1u << t))) continue;
+    long wait = (long)(schedDueMs[t] - now);
+    if (!any || wait < best) {
+      best = wait;
+      any = true;
+    }
+  }
+  dueMs = now + (unsigned long)(best > 0 ? best : 0);
+  return any;
+}
+
+void schedIdle(unsigned long now, unsigned long maxSleepMs) {
+  unsigned long dueMs = 0;
+  if (!schedNextDue(now, dueMs)) dueMs = now + maxSleepMs;
+  if ((long)(dueMs - now) > (long)maxSleepMs) dueMs = now + maxSleepMs;
+
+  unsigned long sleepStartUs = micros();
+  // The 1 ms tick interrupt bounds each WFI; serial input ends the wait early.
+  while ((long)(millis() - dueMs) < 0 && Serial.available() == 0) {
+#if defined(ARDUINO_ARCH_RENESAS)
+    __WFI();
+#else
+    delay(1);
+#endif
+  }
+
+  unsigned long t = micros();
+  windowSleptUs += t - sleepStartUs;
+  bootSleptUs += t - sleepStartUs;
+  if (t - windowStartUs >= SCHED_AWAKE_WINDOW_US) {
+    unsigned long window = t - windowStartUs;
+    unsigned long slept = windowSleptUs < window ? windowSleptUs : window;
+    windowAwakePct = (uint8_t)(100 - (uint64_t)slept * 100 / window);
+    windowStartUs = t;
+    windowSleptUs = 0;
+  }
+}
+
+uint8_t schedAwakePercent() {
+  return windowAwakePct;
+}
+
+uint8_t schedAwakePercentSinceBoot() {
+  accumulateUptime();
+  if (bootUpUs == 0) return 100;
+  uint64_t slept = bootSleptUs < bootUpUs ? bootSleptUs : bootUpUs;
+  return (uint8_t)(100 - slept * 100 / bootUpUs);
+}
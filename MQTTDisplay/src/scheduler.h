@@ -0,0 +1,31 @@
+#pragma once
+
+#include "app_state.h"
+
+enum SchedTask : uint8_t {
+  TASK_UI,
+  TASK_RENDER,
+  TASK_WIPE,
+  TASK_CONN,
+  TASK_PERSIST,
+  TASK_SIM,
+  TASK_HEARTBEAT,
+  TASK_LED,
+  TASK_MQTT_POLL,
+  TASK_TIME,
+  TASK_REFRESH,
+  TASK_COUNT
+};
+
+// Every loop pass starts with an empty deadline table; each subsystem that
+// has pending work declares when it next needs the CPU, and the loop then
+// sleeps until the earliest of those deadlines (or serial input).
+void schedBeginPass();
+void schedAt(SchedTask task, unsigned long dueMs);
+bool schedNextDue(unsigned long now, unsigned long& dueMs);
+// Sleeps until the earliest deadline, at most maxSleepMs.
+void schedIdle(unsigned long now, unsigned long maxSleepMs);
+// Share of wall time spent outside schedIdle's sleep, over the last full
+// minute and since boot.
+uint8_t schedAwakePercent();
+uint8_t schedAwakePercentSinceBoot();
@@ -0,0 +1,130 @@
+#include "sensors.h"
+#include "app_state.h"
+#include "font.h"
+#include "ui.h"
+
+const SensorDef SENSORS[SENSOR_COUNT] = {
+  {"temp", TOPIC_TEMP, toSensorValue(TEMP_MIN_C), toSensorValue(TEMP_MAX_C),
+   toSensorValue(PERSIST_DELTA), toSensorValue(0.1f), F_DEGC, drawTempValue},
+  {"hum",  TOPIC_HUM,  toSensorValue(HUM_MIN),    toSensorValue(HUM_MAX),
+   toSensorValue(PERSIST_DELTA), toSensorValue(0.5f), F_PCT,  drawHumValue},
+};
+
+SensorId findSensor(const char* name) {
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    if (strcmp(SENSORS[i].name, name) == 0) return (SensorId)i;
+  }
+  return SENSOR_COUNT;
+}
+
+// Decimal text to hundredths: optional sign, digits, optional fraction
+// rounded half away from zero at the third decimal, optional exponent
+// ("2.15e1"). Trailing whitespace is skipped; returns a pointer to the first
+// character after that, or nullptr if there was no number. Callers reject
+// anything but '\0' there.
+const char* parseSensorValue(const char* text, int32_t& value) {
+  const char* p = text;
+  while (*p == ' ' || *p == '\t') p++;
+  bool negative = (*p == '-');
+  if (*p == '-' || *p == '+') p++;
+
+  int32_t whole = 0;
+  uint8_t digits = 0;
+  while (*p >= '0' && *p <= '9') {
+    if (whole > 2000000) return nullptr;
+    whole = whole * 10 + (*p++ - '0');
+    digits++;
+  }
+
+  int32_t frac = 0;
+  int32_t fracScale = SENSOR_SCALE;
+  bool roundUp = false;
+  if (*p == '.') {
+    p++;
+    while (*p >= '0' && *p <= '9') {
+      if (fracScale > 1) {
+        fracScale /= 10;
+        frac += (*p - '0') * fracScale;
+      } else if (fracScale == 1) {
+        roundUp = (*p >= '5');
+        fracScale = 0;
+      }
+      p++;
+      digits++;
+    }
+  }
+  if (digits == 0) return nullptr;
+
+  int32_t v = whole * SENSOR_SCALE + frac + (roundUp ? 1 : 0);
+
+  if (*p == 'e' || *p == 'E') {
+    const char* q = p + 1;
+    bool expNegative = (*q == '-');
+    if (*q == '-' || *q == '+') q++;
+    if (*q < '0' || *q > '9') return nullptr;
+    int exp = 0;
+    while (*q >= '0' && *q <= '9') {
+      if (exp < 100) exp = exp * 10 + (*q - '0');
+      q++;
+    }
+    p = q;
+    for (; exp > 0 && v != 0; exp--) {
+      if (expNegative) {
+        v = (v + 5) / 10;
+      } else {
+        if (v > 200000000) return nullptr;
+        v *= 10;
+      }
+    }
+  }
+
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  value = negative ? -v : v;
+  return p;
+}
+
+// Prints a value with one decimal, as the display shows it.
+void printSensorValue(int32_t value) {
+  if (value == SENSOR_NO_VALUE) {
+    Serial.print("none");
+    return;
+  }
+  int32_t tenths = sensorRoundDiv(value, SENSOR_SCALE / 10);
+  if (tenths < 0) {
+    Serial.print("-");
+    tenths = -tenths;
+  }
+  Serial.print(tenths / 10);
+  Serial.print(".");
+  Serial.print(tenths % 10);
+}
+
+// Integer division rounding half away from zero.
+int32_t sensorRoundDiv(int32_t value, int32_t divisor) {
+  return (value < 0) ? -((-value + divisor / 2) / divisor) : (value + divisor / 2) / divisor;
+}
+
+bool sensorInRange(SensorId id, int32_t value) {
+  return value >= SENSORS[id].minValue && value <= SENSORS[id].maxValue;
+}
+
+void sensorStore(AppState& s, SensorId id, int32_t value, unsigned long now) {
+  SensorState& st = s.sensors[id];
+  bool changed = st.value == SENSOR_NO_VALUE || abs(st.value - value) >= SENSORS[id].persistDelta;
+  st.value = value;
+  st.updateMs = now;
+  if (changed) st.updatedSincePersist = true;
+  if (SENSORS[id].historyStep) historyAdd(s.history[id], SENSORS[id].historyStep, value, now);
+}
+
+bool sensorApplyMqtt(AppState& s, SensorId id, int32_t value, unsigned long now) {
+  if (s.sensors[id].simEnabled) return false;
+  if (!sensorInRange(id, value)) return false;
+  sensorStore(s, id, value, now);
+  return true;
+}
+
+void resetSensors(AppState& s) {
+  for (SensorState& st : s.sensors) st = SensorState();
+  for (SensorHistory& h : s.history) historyReset(h);
+}
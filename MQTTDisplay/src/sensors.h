@@ -0,0 +1,56 @@
+#pragma once
+
+#include "platform.h"
+#include "../config.h"
+
+struct AppState;
+
+// Sensors in screen rotation order. Adding one takes an id here, a row in
+// SENSORS (sensors.cpp) and its topic and range in config.h. Journal records
+// store values by id, so new sensors must be appended.
+enum SensorId : uint8_t {
+  SENSOR_TEMP,
+  SENSOR_HUM,
+  SENSOR_COUNT
+};
+
+// Sensor values are fixed-point hundredths (2150 = 21.50) from the parser
+// to the renderer; SENSOR_NO_VALUE marks a sensor that has not reported.
+const int32_t SENSOR_SCALE = 100;
+const int32_t SENSOR_NO_VALUE = INT32_MIN;
+
+// Config ranges are given as float; converted once when the table is built.
+constexpr int32_t toSensorValue(float v) {
+  return (int32_t)(v * SENSOR_SCALE + (v < 0 ? -0.5f : 0.5f));
+}
+
+struct SensorDef {
+  const char* name;            // serial name for show/sim/status
+  const char* topic;
+  int32_t minValue;
+  int32_t maxValue;
+  int32_t persistDelta;        // smallest change worth a journal write
+  int32_t historyStep;         // trend resolution; 0 keeps no history
+  const uint8_t* unitGlyph;    // 3x5 glyph, nullptr if none
+  void (*drawValue)(AppState& s, SensorId id, int32_t value);
+};
+
+struct SensorState {
+  int32_t value = SENSOR_NO_VALUE;
+  unsigned long updateMs = 0;
+  bool updatedSincePersist = false;
+  bool simEnabled = false;
+  int32_t simValue = SENSOR_NO_VALUE;
+};
+
+extern const SensorDef SENSORS[SENSOR_COUNT];
+
+// Returns SENSOR_COUNT if no sensor has that name.
+SensorId findSensor(const char* name);
+const char* parseSensorValue(const char* text, int32_t& value);
+void printSensorValue(int32_t value);
+int32_t sensorRoundDiv(int32_t value, int32_t divisor);
+bool sensorInRange(SensorId id, int32_t value);
+void sensorStore(AppState& s, SensorId id, int32_t value, unsigned long now);
+bool sensorApplyMqtt(AppState& s, SensorId id, int32_t value, unsigned long now);
+void resetSensors(AppState& s);
@@ -0,0 +1,40 @@
+#include "settings.h"
+
+static void restartScreen(AppState& s) {
+  s.screenStartMs = millis();
+}
+
+static void redrawNow(AppState& s) {
+  s.lastUiTickMs = 0;
+}
+
+static void renderNow(AppState& s) {
+  s.lastRenderMs = 0;
+}
+
+const SettingDef SETTINGS[] = {
+  {"show_ms",            &AppState::showMs,           SHOW_MS,            500, 120000, 1, restartScreen},
+  {"ui_tick_ms",         &AppState::uiTickMs,         UI_TICK_MS,          16,   2000, 1, redrawNow},
+  {"display_refresh_ms", &AppState::displayRefreshMs, DISPLAY_REFRESH_MS,   4,   1000, 2, renderNow},
+};
+
+const uint8_t SETTINGS_COUNT = sizeof(SETTINGS) / sizeof(SETTINGS[0]);
+static_assert(SETTINGS_COUNT <= SETTINGS_MAX_FIELDS, "settings record has no room for every setting");
+
+const SettingDef* findSetting(const char* name) {
+  for (uint8_t i = 0; i < SETTINGS_COUNT; i++) {
+    if (strcmp(SETTINGS[i].name, name) == 0) return &SETTINGS[i];
+  }
+  return nullptr;
+}
+
+bool applySetting(AppState& s, const SettingDef& def, unsigned long value) {
+  if (value < def.minValue || value > def.maxValue) return false;
+  s.*def.field = value;
+  if (def.onChange) def.onChange(s);
+  return true;
+}
+
+void resetSettings(AppState& s) {
+  for (uint8_t i = 0; i < SETTINGS_COUNT; i++) applySetting(s, SETTINGS[i], SETTINGS[i].defaultValue);
+}
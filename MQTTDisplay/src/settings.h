@@ -0,0 +1,26 @@
+#pragma once
+
+#include "app_state.h"
+
+// Runtime settings exposed over serial and persisted. Entries are stored by
+// index in the settings record, so new settings must be appended with the
+// record version that introduced them.
+struct SettingDef {
+  const char* name;
+  unsigned long AppState::* field;
+  unsigned long defaultValue;
+  unsigned long minValue;
+  unsigned long maxValue;
+  uint16_t sinceVersion;
+  void (*onChange)(AppState& s);
+};
+
+// Value slots in the persisted settings record.
+const uint8_t SETTINGS_MAX_FIELDS = 8;
+
+extern const SettingDef SETTINGS[];
+extern const uint8_t SETTINGS_COUNT;
+
+const SettingDef* findSetting(const char* name);
+bool applySetting(AppState& s, const SettingDef& def, unsigned long value);
+void resetSettings(AppState& s);
@@ -0,0 +1,243 @@
+#include "sntp.h"
+#include "scheduler.h"
+
+const uint16_t NTP_PORT = 123;
+const uint16_t SNTP_LOCAL_PORT = 2390;
+const uint8_t NTP_PACKET_SIZE = 48;
+const uint32_t NTP_UNIX_OFFSET_S = 2208988800UL;  // 1900-01-01 to 1970-01-01
+
+// Offsets beyond SNTP_STEP_MS are stepped; smaller ones are slewed at up to
+// SNTP_SLEW_PPM (5 ms per second) so the clock never jumps or runs back.
+const long SNTP_STEP_MS = 1000;
+const long SNTP_SLEW_PPM = 5000;
+const long SNTP_MAX_DRIFT_PPM = 500;
+// How often the loop checks for a reply while a request is out; each check
+// is a round trip to the WiFi module.
+const unsigned long SNTP_POLL_MS = 20;
+// After this many timeouts in a row (or a lost link) SNTP_SERVER is looked
+// up again at the next connection setup, in case the pool host went away.
+// The old address stays in use until then.
+const uint8_t SNTP_RESOLVE_AFTER_TIMEOUTS = 3;
+// Rebase well before millis() - baseMs could wrap.
+const unsigned long SNTP_REBASE_MS = 24UL * 60UL * 60UL * 1000UL;
+
+enum SntpState : uint8_t {
+  SNTP_IDLE,
+  SNTP_WAIT_REPLY
+};
+
+static WiFiUDP udp;
+static bool udpOpen = false;
+static SntpState state = SNTP_IDLE;
+static unsigned long sentMs = 0;
+static unsigned long nextSendMs = 0;
+static uint8_t sentStamp[8];
+static IPAddress serverIp;
+static bool serverResolved = false;
+static bool resolveWanted = false;
+static uint8_t timeoutsInRow = 0;
+
+// UTC = baseUtcMs + time since baseMs, scaled by driftPpm, plus the part of
+// slewMs worked off so far.
+static bool synced = false;
+static unsigned long baseMs = 0;
+static int64_t baseUtcMs = 0;
+static long slewMs = 0;
+static unsigned long lastSyncMs = 0;
+static SntpStats stats;
+
+static uint32_t readBe32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void writeBe32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+// Era-safe until 2106: the subtraction wraps like the NTP seconds field.
+static int64_t ntpToUnixMs(const uint8_t* p) {
+  uint32_t sec = readBe32(p) - NTP_UNIX_OFFSET_S;
+  uint32_t frac = readBe32(p + 4);
+  return (int64_t)sec * 1000 + (int64_t)(((uint64_t)frac * 1000) >> 32);
+}
+
+static long appliedSlew(unsigned long elapsed) {
+  long maxSlew = (long)((int64_t)elapsed * SNTP_SLEW_PPM / 1000000);
+  if (slewMs >= 0) return slewMs < maxSlew ? slewMs : maxSlew;
+  return -slewMs < maxSlew ? slewMs : -maxSlew;
+}
+
+// A caller's 'now' may predate baseMs by a few ms when a reply rebased the
+// clock later in the same loop pass; count that as no time passed.
+static unsigned long sinceBase(unsigned long now) {
+  return (long)(now - baseMs) < 0 ? 0 : now - baseMs;
+}
+
+int64_t sntpUtcMs(unsigned long now) {
+  unsigned long elapsed = sinceBase(now);
+  return baseUtcMs + elapsed + (int64_t)elapsed * stats.driftPpm / 1000000 + appliedSlew(elapsed);
+}
+
+static void rebase(unsigned long now) {
+  int64_t t = sntpUtcMs(now);
+  slewMs -= appliedSlew(sinceBase(now));
+  baseUtcMs = t;
+  baseMs = now;
+}
+
+static void applySample(int64_t serverMs, unsigned long now) {
+  if (!synced) {
+    synced = true;
+    baseMs = now;
+    baseUtcMs = serverMs;
+    slewMs = 0;
+    lastSyncMs = now;
+    stats.lastOffsetMs = 0;
+    return;
+  }
+
+  rebase(now);
+  long offset = (long)(serverMs - baseUtcMs);
+  stats.lastOffsetMs = offset;
+
+  if (offset > SNTP_STEP_MS || offset < -SNTP_STEP_MS) {
+    baseUtcMs = serverMs;
+    slewMs = 0;
+  } else {
+    // What the pending slew would not have fixed is drift; take half of it
+    // per sync so one noisy sample cannot swing the rate.
+    unsigned long interval = now - lastSyncMs;
+    if (interval >= SNTP_RETRY_MS) {
+      long drift = stats.driftPpm +
+                   (long)((int64_t)(offset - slewMs) * 1000000 / (int64_t)interval / 2);
+      if (drift > SNTP_MAX_DRIFT_PPM) drift = SNTP_MAX_DRIFT_PPM;
+      if (drift < -SNTP_MAX_DRIFT_PPM) drift = -SNTP_MAX_DRIFT_PPM;
+      stats.driftPpm = drift;
+    }
+    slewMs = offset;
+  }
+  lastSyncMs = now;
+}
+
+static void sendRequest(unsigned long now) {
+  while (udp.parsePacket() > 0) {
+    // Drop late replies to an earlier request.
+  }
+
+  uint8_t buf[NTP_PACKET_SIZE] = {0};
+  buf[0] = 0x23;  // LI 0, version 4, mode 3 (client)
+  // A nonce in the transmit timestamp; the server echoes it as originate.
+  writeBe32(sentStamp, micros());
+  writeBe32(sentStamp + 4, now);
+  memcpy(buf + 40, sentStamp, sizeof(sentStamp));
+
+  // Fresh, like rxMs: the loop's 'now' may be a slow pass old.
+  sentMs = millis();
+  state = SNTP_WAIT_REPLY;
+  // Failures here count as a timeout.
+  if (!udp.beginPacket(serverIp, NTP_PORT)) return;
+  udp.write(buf, sizeof(buf));
+  udp.endPacket();
+}
+
+// The RTT is measured with fresh millis() on both ends, but the sample is applied at
+// the loop's 'now' so the clock base is never ahead of what callers hold.
+static bool readReply(unsigned long now) {
+  int len = udp.parsePacket();
+  if (len <= 0) return false;
+  unsigned long rxMs = millis();
+  if (len < NTP_PACKET_SIZE) return false;
+
+  uint8_t buf[NTP_PACKET_SIZE];
+  udp.read(buf, sizeof(buf));
+  uint8_t mode = buf[0] & 0x07;
+  uint8_t stratum = buf[1];
+  // Stratum 0 is a kiss-o'-death; a wrong originate is not our request.
+  if (mode != 4 || stratum == 0 || stratum > 15) return false;
+  if (memcmp(buf + 24, sentStamp, sizeof(sentStamp)) != 0) return false;
+
+  unsigned long rtt = rxMs - sentMs;
+  int64_t received = ntpToUnixMs(buf + 32);
+  int64_t transmitted = ntpToUnixMs(buf + 40);
+  int64_t serverHold = transmitted - received;
+  if (serverHold < 0 || serverHold > (int64_t)rtt) serverHold = 0;
+
+  stats.lastRttMs = rtt;
+  int64_t serverAtRx = transmitted + ((int64_t)rtt - serverHold) / 2;
+  applySample(serverAtRx - (int64_t)(rxMs - now), now);
+  return true;
+}
+
+void sntpTick(unsigned long now, bool networkUp) {
+  if (synced && sinceBase(now) >= SNTP_REBASE_MS) rebase(now);
+
+  if (!networkUp) {
+    if (udpOpen) udp.stop();
+    udpOpen = false;
+    resolveWanted = true;
+    state = SNTP_IDLE;
+    return;
+  }
+  if (!udpOpen) {
+    udpOpen = udp.begin(SNTP_LOCAL_PORT);
+    if (!udpOpen) return;
+    nextSendMs = now;
+  }
+
+  if (state == SNTP_IDLE) {
+    // No address until the connection setup has looked one up.
+    if (!serverResolved) return;
+    if ((long)(now - nextSendMs) < 0) {
+      schedAt(TASK_TIME, nextSendMs);
+      return;
+    }
+    sendRequest(now);
+    schedAt(TASK_TIME, now + SNTP_POLL_MS);
+    return;
+  }
+
+  if (readReply(now)) {
+    state = SNTP_IDLE;
+    timeoutsInRow = 0;
+    stats.syncs++;
+    nextSendMs = now + SNTP_RESYNC_MS;
+    schedAt(TASK_TIME, nextSendMs);
+  } else if (now - sentMs >= SNTP_TIMEOUT_MS) {
+    state = SNTP_IDLE;
+    stats.timeouts++;
+    if (++timeoutsInRow >= SNTP_RESOLVE_AFTER_TIMEOUTS) {
+      timeoutsInRow = 0;
+      resolveWanted = true;
+    }
+    nextSendMs = now + SNTP_RETRY_MS;
+    schedAt(TASK_TIME, nextSendMs);
+  } else {
+    schedAt(TASK_TIME, now + SNTP_POLL_MS);
+  }
+}
+
+void sntpResolveServer() {
+  if (serverResolved && !resolveWanted) return;
+  // The lookup blocks; a reply arriving meanwhile would count the wait as
+  // round trip, so a request in flight is sent again afterwards.
+  if (state == SNTP_WAIT_REPLY) {
+    state = SNTP_IDLE;
+    nextSendMs = sentMs;
+  }
+  IPAddress ip;
+  if (WiFi.hostByName(SNTP_SERVER, ip) != 1) return;
+  serverIp = ip;
+  serverResolved = true;
+  resolveWanted = false;
+}
+
+bool sntpSynced() {
+  return synced;
+}
+
+const SntpStats& sntpStats() {
+  return stats;
+}
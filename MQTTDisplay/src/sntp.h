@@ -0,0 +1,26 @@
+#pragma once
+
+#include "platform.h"
+#include "../config.h"
+
+// Non-blocking SNTP client and the UTC clock it disciplines. One request is
+// in flight at a time and replies are picked up by sntpTick, so nothing here
+// waits on the network. After the first reply the clock is only slewed, and
+// the local oscillator's drift is tracked between resyncs.
+struct SntpStats {
+  unsigned long syncs = 0;
+  unsigned long timeouts = 0;
+  long lastOffsetMs = 0;      // error measured at the last sync
+  long driftPpm = 0;          // local clock rate correction
+  unsigned long lastRttMs = 0;
+};
+
+void sntpTick(unsigned long now, bool networkUp);
+// Looks up SNTP_SERVER if there is no address yet or sntpTick asked for a
+// fresh one. The lookup blocks, so only the connection setup calls this;
+// sntpTick never does, and waits for an address instead.
+void sntpResolveServer();
+bool sntpSynced();
+// Milliseconds since the Unix epoch; only meaningful once sntpSynced().
+int64_t sntpUtcMs(unsigned long now);
+const SntpStats& sntpStats();
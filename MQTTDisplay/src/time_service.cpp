@@ -1,7 +1,19 @@
 #include "time_service.h"
+#include "sntp.h"
 
 static Timezone tzBerlin;
-static bool timeSyncAttempted = false;
+
+// The UTC offset stays valid for UTC in [offsetFromUtc, offsetUntilUtc), so
+// the DST rules are only evaluated again at the next transition.
+static time_t offsetFromUtc = 0;
+static time_t offsetUntilUtc = 0;
+static long offsetSec = 0;
+
+static time_t snapshotUtc = 0;
+static LocalTime snapshot = {};
+
+const long DST_SEARCH_STEP_S = 7L * 86400L;
+const uint8_t DST_SEARCH_STEPS = 54;  // a little over a year
 
 void initTimeService(AppState& s) {
   tzBerlin.setCache(EZTIME_CACHE_ADDR);
@@ -11,19 +23,66 @@ void initTimeService(AppState& s) {
     tzBerlin.setPosix("CET-1CEST,M3.5.0/2,M10.5.0/3");
   }
   tzBerlin.setDefault();
-  setServer("pool.ntp.org");
+  // ezTime only supplies the zone rules; sntp.cpp keeps the clock.
+  setInterval(0);
   s.timeValid = false;
 }
 
-void timeServiceTick(AppState& s) {
-  events();
+static long berlinOffsetAt(time_t utc) {
+  return (long)(tzBerlin.tzTime(utc, UTC_TIME) - utc);
+}
 
-  if (!timeSyncAttempted && WiFi.status() == WL_CONNECTED) {
-    timeSyncAttempted = true;
-    waitForSync();
+// Finds the first second after 'utc' with a different offset: weekly probes,
+// then bisection down to the second. Runs at sync and at each transition.
+static void updateOffset(time_t utc) {
+  offsetSec = berlinOffsetAt(utc);
+  offsetFromUtc = utc;
+
+  time_t lo = utc;
+  time_t hi = 0;
+  for (uint8_t i = 1; i <= DST_SEARCH_STEPS; i++) {
+    time_t probe = utc + (time_t)i * DST_SEARCH_STEP_S;
+    if (berlinOffsetAt(probe) != offsetSec) {
+      hi = probe;
+      break;
+    }
+    lo = probe;
+  }
+  if (hi == 0) {
+    // No transition within a year; look again once that has passed.
+    offsetUntilUtc = lo;
+    return;
   }
+  while (hi - lo > 1) {
+    time_t mid = lo + (hi - lo) / 2;
+    if (berlinOffsetAt(mid) == offsetSec) lo = mid;
+    else hi = mid;
+  }
+  offsetUntilUtc = hi;
+}
 
-  s.timeValid = timeStatus() != timeNotSet;
+static void refreshSnapshot(unsigned long now) {
+  time_t utc = (time_t)(sntpUtcMs(now) / 1000);
+  if (utc == snapshotUtc) return;
+  snapshotUtc = utc;
+  // Also recomputes after a sync stepped the clock backwards.
+  if (utc < offsetFromUtc || utc >= offsetUntilUtc) updateOffset(utc);
+
+  time_t local = utc + offsetSec;
+  snapshot.localSeconds = local;
+  unsigned long secOfDay = (unsigned long)(local % 86400L);
+  snapshot.hour = (uint8_t)(secOfDay / 3600UL);
+  snapshot.minute = (uint8_t)((secOfDay / 60UL) % 60UL);
+  snapshot.second = (uint8_t)(secOfDay % 60UL);
+  snapshot.weekday0 = (uint8_t)((local / 86400L + 4) % 7);  // 1970-01-01 was a Thursday
+}
+
+void timeServiceTick(AppState& s, unsigned long now) {
+  events();
+  sntpTick(now, WiFi.status() == WL_CONNECTED);
+
+  s.timeValid = sntpSynced();
+  if (s.timeValid) refreshSnapshot(now);
 
 #if SERIAL_DEBUG
   static bool once = false;
@@ -39,30 +98,22 @@ bool timeIsValid(const AppState& s) {
   return s.timeValid;
 }
 
-int berlinHour() {
-  return tzBerlin.hour();
-}
-
-int berlinMinute() {
-  return tzBerlin.minute();
-}
-
-int berlinSecond() {
-  return tzBerlin.second();
+const LocalTime& berlinNow() {
+  return snapshot;
 }
 
-int berlinWeekday0() {
-  int wd = tzBerlin.weekday(); // 1=Sun..7=Sat
-  return wd - 1;
+unsigned long msToNextMinute(unsigned long now) {
+  return 60000UL - (unsigned long)(sntpUtcMs(now) % 60000);
 }
 
 void printBerlinTimeLine(const AppState& s) {
   if (!timeIsValid(s)) return;
 
-  int hh = berlinHour();
-  int mm = berlinMinute();
-  int ss = berlinSecond();
-  int dow = berlinWeekday0();
+  const LocalTime& t = berlinNow();
+  int hh = t.hour;
+  int mm = t.minute;
+  int ss = t.second;
+  int dow = t.weekday0;
 
   static const char* DOW_NAME[7] = {"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
 
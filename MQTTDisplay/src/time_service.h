@@ -3,10 +3,20 @@
 #include "app_state.h"
 
 void initTimeService(AppState& s);
-void timeServiceTick(AppState& s);
+void timeServiceTick(AppState& s, unsigned long now);
 bool timeIsValid(const AppState& s);
-int berlinHour();
-int berlinMinute();
-int berlinSecond();
-int berlinWeekday0(); // 0=Sun..6=Sat
+
+// Broken-down Berlin time, refreshed by timeServiceTick when the second
+// rolls over. Only meaningful while timeIsValid().
+struct LocalTime {
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t weekday0;  // 0=Sun..6=Sat
+  time_t localSeconds;  // Unix time shifted by the current UTC offset
+};
+
+const LocalTime& berlinNow();
+// Milliseconds until the next local minute starts.
+unsigned long msToNextMinute(unsigned long now);
 void printBerlinTimeLine(const AppState& s);
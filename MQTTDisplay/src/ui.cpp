@@ -2,18 +2,25 @@
 #include "font.h"
 #include "time_service.h"
 #include "matrix_io.h"
+#include "scheduler.h"
+#include "anim.h"
 
 const uint8_t WipeAnim::order[12] = {5,6,4,7,3,8,2,9,1,10,0,11};
 
+// Level for secondary elements (progress bar, stale badge). Dimming them
+// keeps the BAM refresh running on every data screen, so it is opt-in.
+const uint8_t UI_DIM_LEVEL = UI_DIM_SECONDARY ? 1 : GRAY_MAX;
+
 void clearFrame(AppState& s) {
-  for (int r = 0; r < 8; r++)
-    for (int c = 0; c < 12; c++)
-      s.frame[r][c] = 0;
+  grayClear(s.frame);
 }
 
 void setPixel(AppState& s, int x, int y, bool on) {
-  if (x < 0 || x >= 12 || y < 0 || y >= 8) return;
-  s.frame[y][x] = on ? 1 : 0;
+  graySetPixel(s.frame, x, y, on ? GRAY_MAX : 0);
+}
+
+void setPixelLevel(AppState& s, int x, int y, uint8_t level) {
+  graySetPixel(s.frame, x, y, level > GRAY_MAX ? GRAY_MAX : level);
 }
 
 void draw3x5(AppState& s, const uint8_t glyph[5], int x0, int y0) {
@@ -34,16 +41,36 @@ void drawTwoDigits(AppState& s, int value, int x0, int y0) {
   draw3x5(s, digitFont(ones), x0 + 4, y0);
 }
 
-void drawTempTenths(AppState& s, float tempC, int x0, int y0) {
-  int temp10 = (int)roundf(tempC * 10.0f);
-  int whole = temp10 / 10;
-  int tenths = abs(temp10 % 10);
+static void drawMinus(AppState& s, int x0, int y0) {
+  setPixel(s, x0 + 0, y0 + 2, true);
+  setPixel(s, x0 + 1, y0 + 2, true);
+  setPixel(s, x0 + 2, y0 + 2, true);
+}
 
-  whole = constrain(whole, 0, 99);
-  drawTwoDigits(s, whole, x0, y0);
+// "21.4", "-7.3", "-12" (no room for the tenth) or "105" for tenths >= 100.0.
+void drawTempTenths(AppState& s, int32_t tenths, int x0, int y0) {
+  if (tenths <= -100) {
+    drawMinus(s, x0, y0);
+    drawTwoDigits(s, (int)sensorRoundDiv(-tenths, 10), x0 + 4, y0);
+    return;
+  }
+  if (tenths >= 1000) {
+    int whole = constrain((int)sensorRoundDiv(tenths, 10), 0, 999);
+    draw3x5(s, digitFont(whole / 100), x0, y0);
+    drawTwoDigits(s, whole % 100, x0 + 4, y0);
+    return;
+  }
+
+  int t = (int)(tenths < 0 ? -tenths : tenths);
+  if (tenths < 0) {
+    drawMinus(s, x0, y0);
+    draw3x5(s, digitFont(t / 10), x0 + 4, y0);
+  } else {
+    drawTwoDigits(s, t / 10, x0, y0);
+  }
 
   setPixel(s, x0 + 7, y0 + 4, true);
-  draw3x5(s, digitFont(tenths), x0 + 8, y0);
+  draw3x5(s, digitFont(t % 10), x0 + 8, y0);
 }
 
 void drawNoDataGlyph(AppState& s, int x0, int y0) {
@@ -60,25 +87,23 @@ void drawStaleIndicator(AppState& s, unsigned long now, bool stale) {
   if (((now / 400) % 2) != 0) return;
 
   // Explicit stale badge: tiny "!" in the top-left corner.
-  setPixel(s, 0, 0, true);
-  setPixel(s, 0, 1, true);
-  setPixel(s, 0, 3, true);
-  setPixel(s, 1, 0, true);
+  setPixelLevel(s, 0, 0, UI_DIM_LEVEL);
+  setPixelLevel(s, 0, 1, UI_DIM_LEVEL);
+  setPixelLevel(s, 0, 3, UI_DIM_LEVEL);
+  setPixelLevel(s, 1, 0, UI_DIM_LEVEL);
 }
 
 
 void render(AppState& s) {
-  matrixRenderBitmap(s, s.frame);
+  matrixRenderGray(s, s.frame);
 }
 
-void renderFrame(AppState& s, uint8_t f[8][12]) {
-  matrixRenderBitmap(s, f);
+void renderFrame(AppState& s, const GrayFrame& f) {
+  matrixRenderGray(s, f);
 }
 
-void copyFrame(uint8_t dst[8][12], uint8_t src[8][12]) {
-  for (int r = 0; r < 8; r++)
-    for (int c = 0; c < 12; c++)
-      dst[r][c] = src[r][c];
+void copyFrame(GrayFrame& dst, const Frame& src) {
+  grayFromFrame(dst, src);
 }
 
 void drawProgressBar(AppState& s, unsigned long now, unsigned long elapsed, unsigned long total) {
@@ -92,7 +117,7 @@ void drawProgressBar(AppState& s, unsigned long now, unsigned long elapsed, unsi
   if (step > 2) step = 2;
 
   for (int x = 9; x <= 11; x++) setPixel(s, x, 7, false);
-  for (int i = 0; i <= step; i++) setPixel(s, 9 + i, 7, true);
+  for (int i = 0; i <= step; i++) setPixelLevel(s, 9 + i, 7, UI_DIM_LEVEL);
   if (p > 0.90f && ((now / 200) % 2) == 0) setPixel(s, 11, 7, false);
 }
 
@@ -126,106 +151,56 @@ static void drawTinyDigit2x4(AppState& s, int d, int x0, int y0) {
 }
 
 void drawBigX(AppState& s, unsigned long now) {
-  (void)now;
-  clearFrame(s);
-
-  bool pulse = ((millis() / 900) % 2) == 0;
-  for (int i = 0; i < 8; i++) {
-    int x1 = (int)roundf(i * (11.0f / 7.0f));
-    int x2 = 11 - x1;
-    setPixel(s, x1, i, true);
-    setPixel(s, x2, i, true);
-  }
-
-  if (pulse) {
-    setPixel(s, 0, 0, true);
-    setPixel(s, 11, 0, true);
-    setPixel(s, 0, 7, true);
-    setPixel(s, 11, 7, true);
-  }
-
+  copyFrame(s.frame, bigXFrame(now));
   render(s);
 }
 
 void drawWifiBarsAnim(AppState& s, int step) {
-  clearFrame(s);
-  setPixel(s, 0, 6, true);
-
-  const int xs[4] = {2, 4, 6, 8};
-  const int h[4]  = {1, 2, 3, 4};
-  static const uint8_t wave[24] = {
-    0,1,2,3,4,3,2,1,0,0,1,2,
-    3,4,3,2,1,0,0,1,2,3,2,1
-  };
-
-  for (int b = 0; b < 4; b++) {
-    int idx = (step + b * 4) % 24;
-    int lit = wave[idx];
-    if (lit > h[b]) lit = h[b];
-    for (int yy = 0; yy < lit; yy++) setPixel(s, xs[b], 6 - yy, true);
-  }
-
-  // Tiny sparkle on the tallest bar at the wave peak.
-  if (wave[(step + 12) % 24] >= 4) {
-    setPixel(s, 8, 2, true);
-  }
+  copyFrame(s.frame, wifiAnimFrame(step));
   render(s);
 }
 
 void drawMqttAnimSmooth(AppState& s, unsigned long phase) {
-  clearFrame(s);
-
-  const int xmin = 2;
-  const int xmax = 9;
-  const int span = (xmax - xmin);
-
-  int cycleLen = span * 2;
-  int p = (int)(phase % cycleLen);
+  copyFrame(s.frame, mqttAnimFrame(phase));
+  render(s);
+}
 
-  int x;
-  bool forward;
-  if (p <= span) {
-    x = xmin + p;
-    forward = true;
-  } else {
-    x = xmax - (p - span);
-    forward = false;
+// Small diagonal arrow (rising / falling) or a dash in a 3x3 cell.
+static void drawTrendArrow(AppState& s, int8_t trend, int x0, int y0) {
+  for (int i = 0; i < 3; i++) {
+    if (trend > 0)      setPixel(s, x0 + i, y0 + 2 - i, true);
+    else if (trend < 0) setPixel(s, x0 + i, y0 + i, true);
+    else                setPixel(s, x0 + i, y0 + 1, true);
   }
+}
 
-  int y = 3 + ((phase / 4) & 0x1);
-  setPixel(s, x, y, true);
-  setPixel(s, x, y + 1, true);
-
-  // Tail and a tiny flicker nose for a "packet" feel.
-  if (forward) {
-    if (x - 2 >= xmin) setPixel(s, x - 2, y + 1, true);
-    if ((phase & 0x1) == 0 && x + 1 <= xmax) setPixel(s, x + 1, y, true);
-  } else {
-    if (x + 2 <= xmax) setPixel(s, x + 2, y + 1, true);
-    if ((phase & 0x1) == 0 && x - 1 >= xmin) setPixel(s, x - 1, y, true);
-  }
+void drawTempValue(AppState& s, SensorId id, int32_t value) {
+  drawTempTenths(s, sensorRoundDiv(value, SENSOR_SCALE / 10), 0, 0);
+  int32_t step = SENSORS[id].historyStep;
+  if (step) drawTrendArrow(s, historyTrend(s.history[id], step, value), 0, 5);
+}
 
-  // Endpoints (nodes) with subtle pulse on arrival.
-  bool pulseL = (x == xmin) && ((phase & 0x3) == 0);
-  bool pulseR = (x == xmax) && ((phase & 0x3) == 0);
-  setPixel(s, 0, 4, true);
-  setPixel(s, 0, 5, true);
-  setPixel(s, 11, 2, true);
-  setPixel(s, 11, 3, true);
-  setPixel(s, 11, 4, true);
-  if (pulseL) setPixel(s, 1, 4, true);
-  if (pulseR) setPixel(s, 10, 3, true);
+void drawHumValue(AppState& s, SensorId id, int32_t value) {
+  int hum = constrain((int)sensorRoundDiv(value, SENSOR_SCALE), 0, 99);
+  drawTwoDigits(s, hum, 1, 0);
+  if (SENSORS[id].unitGlyph) draw3x5(s, SENSORS[id].unitGlyph, 9, 0);
+  drawHumLevelBar(s, hum);
+}
 
-  render(s);
+static bool anySensorStale(const AppState& s, unsigned long now) {
+  for (const SensorState& st : s.sensors) {
+    if (isStale(now, st.updateMs)) return true;
+  }
+  return false;
 }
 
-void drawTempScreen(AppState& s, unsigned long now, unsigned long elapsed) {
+void drawSensorScreen(AppState& s, SensorId id, unsigned long now, unsigned long elapsed) {
   clearFrame(s);
 
-  bool stale = isStale(now, s.lastTempUpdateMs);
-  drawStaleIndicator(s, now, stale);
-  if (!isnan(s.lastTemp)) {
-    drawTempTenths(s, s.lastTemp, 0, 0);
+  const SensorState& st = s.sensors[id];
+  drawStaleIndicator(s, now, isStale(now, st.updateMs));
+  if (st.value != SENSOR_NO_VALUE) {
+    SENSORS[id].drawValue(s, id, st.value);
   } else {
     drawNoDataGlyph(s, 4, 1);
   }
@@ -234,18 +209,43 @@ void drawTempScreen(AppState& s, unsigned long now, unsigned long elapsed) {
   render(s);
 }
 
-void drawHumScreen(AppState& s, unsigned long now, unsigned long elapsed) {
+// One column per history bucket, oldest on the left, each drawn as a bar
+// from the bucket's min to max. Rows 0..6; row 7 keeps the progress bar.
+void drawTrendScreen(AppState& s, SensorId id, unsigned long now, unsigned long elapsed) {
   clearFrame(s);
 
-  bool stale = isStale(now, s.lastHumUpdateMs);
-  drawStaleIndicator(s, now, stale);
-  if (!isnan(s.lastHum)) {
-    int hum = constrain((int)roundf(s.lastHum), 0, 99);
-    drawTwoDigits(s, hum, 1, 0);
-    draw3x5(s, F_PCT, 9, 0);
-    drawHumLevelBar(s, hum);
-  } else {
+  int32_t step = SENSORS[id].historyStep;
+  SensorHistory& h = s.history[id];
+  historyAdvance(h, step, now);
+
+  int32_t lo[FRAME_W];
+  int32_t hi[FRAME_W];
+  bool has[FRAME_W];
+  int32_t minV = INT32_MAX;
+  int32_t maxV = INT32_MIN;
+  for (uint8_t x = 0; x < FRAME_W; x++) {
+    has[x] = historyColumn(h, step, x, lo[x], hi[x]);
+    if (!has[x]) continue;
+    if (lo[x] < minV) minV = lo[x];
+    if (hi[x] > maxV) maxV = hi[x];
+  }
+
+  drawStaleIndicator(s, now, isStale(now, s.sensors[id].updateMs));
+  if (minV > maxV) {
     drawNoDataGlyph(s, 4, 1);
+  } else {
+    // Keep at least 6 steps of vertical range so noise stays flat.
+    int32_t span = maxV - minV;
+    if (span < 6 * step) {
+      minV -= (6 * step - span) / 2;
+      span = 6 * step;
+    }
+    for (uint8_t x = 0; x < FRAME_W; x++) {
+      if (!has[x]) continue;
+      int yTop = 6 - (int)(((int64_t)(hi[x] - minV) * 6 + span / 2) / span);
+      int yBottom = 6 - (int)(((int64_t)(lo[x] - minV) * 6 + span / 2) / span);
+      for (int y = yTop; y <= yBottom; y++) setPixel(s, x, y, true);
+    }
   }
 
   drawProgressBar(s, now, elapsed, s.showMs);
@@ -254,7 +254,7 @@ void drawHumScreen(AppState& s, unsigned long now, unsigned long elapsed) {
 
 void drawClockPlaceholder(AppState& s, unsigned long now, unsigned long elapsed) {
   clearFrame(s);
-  bool stale = isStale(now, s.lastTempUpdateMs) || isStale(now, s.lastHumUpdateMs);
+  bool stale = anySensorStale(s, now);
   drawStaleIndicator(s, now, stale);
   int y = 3;
   for (int i = 0; i < 4; i++) {
@@ -273,13 +273,13 @@ void drawClockScreen(AppState& s, unsigned long now, unsigned long elapsed) {
     return;
   }
 
-  int hh = berlinHour();
-  int mm = berlinMinute();
+  int hh = berlinNow().hour;
+  int mm = berlinNow().minute;
   (void)elapsed;
 
   clearFrame(s);
 
-  bool stale = isStale(now, s.lastTempUpdateMs) || isStale(now, s.lastHumUpdateMs);
+  bool stale = anySensorStale(s, now);
   drawStaleIndicator(s, now, stale);
   bool showHours = ((now / CLOCK_TOGGLE_MS) % 2) == 0;
   int value = showHours ? hh : mm;
@@ -298,8 +298,8 @@ void drawClockMinimal(AppState& s, unsigned long now, unsigned long elapsed) {
     return;
   }
 
-  int hh = berlinHour();
-  int mm = berlinMinute();
+  int hh = berlinNow().hour;
+  int mm = berlinNow().minute;
   (void)now;
   (void)elapsed;
   bool showHours = ((now / CLOCK_TOGGLE_MS) % 2) == 0;
@@ -310,10 +310,58 @@ void drawClockMinimal(AppState& s, unsigned long now, unsigned long elapsed) {
   render(s);
 }
 
-void startWipe(AppState& s, unsigned long now,
-               void (*drawFrom)(AppState&, unsigned long, unsigned long),
-               void (*drawTo)(AppState&, unsigned long, unsigned long),
-               ScreenMode targetMode) {
+void drawScreen(AppState& s, ScreenMode mode, unsigned long now, unsigned long elapsed) {
+  if (mode < SCREEN_TREND)      drawSensorScreen(s, (SensorId)mode, now, elapsed);
+  else if (mode < SCREEN_CLOCK) drawTrendScreen(s, (SensorId)(mode - SCREEN_TREND), now, elapsed);
+  else                          drawClockScreen(s, now, elapsed);
+}
+
+static bool screenEnabled(ScreenMode mode) {
+  if (mode >= SCREEN_TREND && mode < SCREEN_CLOCK) return SENSORS[mode - SCREEN_TREND].historyStep != 0;
+  return mode < SCREEN_COUNT;
+}
+
+ScreenMode nextScreen(ScreenMode mode, ScreenMask mask) {
+  for (uint8_t i = 0; i < SCREEN_COUNT; i++) {
+    ScreenMode next = (ScreenMode)((mode + 1 + i) % SCREEN_COUNT);
+    if (screenEnabled(next) && (mask == 0 || (mask & ((ScreenMask)1 << next)))) return next;
+  }
+  return mode;
+}
+
+// Sensor screens use the sensor name, trend screens "<name>_trend".
+void printScreenName(ScreenMode mode) {
+  if (mode < SCREEN_TREND) {
+    Serial.print(SENSORS[mode].name);
+  } else if (mode < SCREEN_CLOCK) {
+    Serial.print(SENSORS[mode - SCREEN_TREND].name);
+    Serial.print("_trend");
+  } else {
+    Serial.print("clock");
+  }
+}
+
+bool parseScreenName(const char* name, ScreenMode& mode) {
+  if (strcmp(name, "clock") == 0) {
+    mode = SCREEN_CLOCK;
+    return true;
+  }
+  char sensor[24];
+  size_t len = strlen(name);
+  const size_t suffix = 6;  // "_trend"
+  bool trend = len > suffix && len - suffix < sizeof(sensor) && strcmp(name + len - suffix, "_trend") == 0;
+  if (trend) {
+    memcpy(sensor, name, len - suffix);
+    sensor[len - suffix] = '\0';
+    name = sensor;
+  }
+  SensorId id = findSensor(name);
+  if (id == SENSOR_COUNT) return false;
+  mode = trend ? (ScreenMode)(SCREEN_TREND + id) : (ScreenMode)id;
+  return screenEnabled(mode);
+}
+
+void startWipe(AppState& s, unsigned long now, ScreenMode fromMode, ScreenMode targetMode) {
   s.wipe.active = true;
   s.wipe.step = 0;
   s.wipe.nextStepMs = now;
@@ -321,27 +369,36 @@ void startWipe(AppState& s, unsigned long now,
   if (s.wipe.stepIntervalMs < 8) s.wipe.stepIntervalMs = 8;
   s.wipe.nextMode = targetMode;
 
-  drawFrom(s, now, 0);
-  copyFrame(s.wipe.from, s.frame);
+  drawScreen(s, fromMode, now, 0);
+  grayCopy(s.wipe.from, s.frame);
 
-  drawTo(s, now, 0);
-  copyFrame(s.wipe.to, s.frame);
+  drawScreen(s, targetMode, now, 0);
+  grayCopy(s.wipe.to, s.frame);
 
-  copyFrame(s.wipe.out, s.wipe.from);
+  grayCopy(s.wipe.out, s.wipe.from);
+  schedAt(TASK_WIPE, s.wipe.nextStepMs);
 }
 
 void tickWipe(AppState& s, unsigned long now) {
   if (!s.wipe.active) return;
-  if ((long)(now - s.wipe.nextStepMs) < 0) return;
-
-  if (s.mqttClient.connected()) s.mqttClient.poll();
+  if ((long)(now - s.wipe.nextStepMs) < 0) {
+    schedAt(TASK_WIPE, s.wipe.nextStepMs);
+    return;
+  }
 
   int col = WipeAnim::order[s.wipe.step];
-  for (int r = 0; r < 8; r++) s.wipe.out[r][col] = s.wipe.to[r][col];
+  grayBlit(s.wipe.out, s.wipe.to, FRAME_COLUMN_MASK[col]);
+  // Cross-fade the column the wipe reaches next so the edge moves smoothly.
+  if (s.wipe.step + 1 < 12) {
+    int edge = WipeAnim::order[s.wipe.step + 1];
+    grayAverage(s.wipe.out, s.wipe.from, s.wipe.to, FRAME_COLUMN_MASK[edge]);
+  }
   renderFrame(s, s.wipe.out);
 
   s.wipe.step++;
-  s.wipe.nextStepMs = now + s.wipe.stepIntervalMs;
+  // Step on the original grid; only resync if a whole step was missed.
+  s.wipe.nextStepMs += s.wipe.stepIntervalMs;
+  if ((long)(now - s.wipe.nextStepMs) >= 0) s.wipe.nextStepMs = now + s.wipe.stepIntervalMs;
 
   if (s.wipe.step >= 12) {
     s.wipe.active = false;
@@ -349,5 +406,8 @@ void tickWipe(AppState& s, unsigned long now) {
     s.mode = s.wipe.nextMode;
     s.screenStartMs = now;
     s.lastUiTickMs = 0;
+    schedAt(TASK_UI, now);
+  } else {
+    schedAt(TASK_WIPE, s.wipe.nextStepMs);
   }
 }
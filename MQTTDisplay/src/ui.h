@@ -4,26 +4,34 @@
 
 void clearFrame(AppState& s);
 void setPixel(AppState& s, int x, int y, bool on = true);
+// Sets one pixel to an intensity level, 0..GRAY_MAX.
+void setPixelLevel(AppState& s, int x, int y, uint8_t level);
 void draw3x5(AppState& s, const uint8_t glyph[5], int x0, int y0);
 void drawTwoDigits(AppState& s, int value, int x0, int y0);
-void drawTempTenths(AppState& s, float tempC, int x0, int y0);
+void drawTempTenths(AppState& s, int32_t tenths, int x0, int y0);
 void drawNoDataGlyph(AppState& s, int x0, int y0);
 bool isStale(unsigned long now, unsigned long lastMs);
 void drawStaleIndicator(AppState& s, unsigned long now, bool stale);
 void render(AppState& s);
-void renderFrame(AppState& s, uint8_t f[8][12]);
-void copyFrame(uint8_t dst[8][12], uint8_t src[8][12]);
+void renderFrame(AppState& s, const GrayFrame& f);
+// Loads a binary frame into dst at full intensity.
+void copyFrame(GrayFrame& dst, const Frame& src);
 void drawProgressBar(AppState& s, unsigned long now, unsigned long elapsed, unsigned long total);
 void drawBigX(AppState& s, unsigned long now);
 void drawWifiBarsAnim(AppState& s, int step);
 void drawMqttAnimSmooth(AppState& s, unsigned long phase);
-void drawTempScreen(AppState& s, unsigned long now, unsigned long elapsed);
-void drawHumScreen(AppState& s, unsigned long now, unsigned long elapsed);
+void drawTempValue(AppState& s, SensorId id, int32_t value);
+void drawHumValue(AppState& s, SensorId id, int32_t value);
+void drawSensorScreen(AppState& s, SensorId id, unsigned long now, unsigned long elapsed);
+void drawTrendScreen(AppState& s, SensorId id, unsigned long now, unsigned long elapsed);
 void drawClockPlaceholder(AppState& s, unsigned long now, unsigned long elapsed);
 void drawClockScreen(AppState& s, unsigned long now, unsigned long elapsed);
 void drawClockMinimal(AppState& s, unsigned long now, unsigned long elapsed);
-void startWipe(AppState& s, unsigned long now,
-               void (*drawFrom)(AppState&, unsigned long, unsigned long),
-               void (*drawTo)(AppState&, unsigned long, unsigned long),
-               ScreenMode targetMode);
+void drawScreen(AppState& s, ScreenMode mode, unsigned long now, unsigned long elapsed);
+// Next enabled screen in rotation order, limited to 'mask' (bit per
+// ScreenMode) unless it is 0.
+ScreenMode nextScreen(ScreenMode mode, ScreenMask mask);
+void printScreenName(ScreenMode mode);
+bool parseScreenName(const char* name, ScreenMode& mode);
+void startWipe(AppState& s, unsigned long now, ScreenMode fromMode, ScreenMode targetMode);
 void tickWipe(AppState& s, unsigned long now);
@@ -0,0 +1,33 @@
+// Host run of the serial "bench" command: boots the sketch on the fakes,
+// waits for the display to come up, then times the render cases against
+// the host's real clock. Numbers compare builds on one machine; they say
+// nothing about cycles on the RA4M1.
+//
+//   bench_render [iterations 1..5000]
+
+#include <stdlib.h>
+
+#include "harness.h"
+
+#include "app_state.h"
+
+int main(int argc, char** argv) {
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5000;
+
+  host::broker().publish(TOPIC_TEMP, "21.5", 1, true);
+  host::broker().publish(TOPIC_HUM, "48", 1, true);
+  setup();
+  CHECK(harness::runUntil([] { return app.connState == CONN_OK; }, 60000));
+  harness::runFor(1000);
+
+  host::setWallClock(true);
+  std::string out = harness::command("bench " + std::to_string(iterations));
+  host::setWallClock(false);
+
+  fputs(out.c_str(), stdout);
+  CHECK(harness::contains(out, "bench temp ns="));
+  CHECK(harness::contains(out, "bench push_gray ns="));
+  CHECK(harness::contains(out, "bench ui_load="));
+  CHECK(harness::contains(out, "OK bench"));
+  return harness::finish("bench_render");
+}
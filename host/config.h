@@ -0,0 +1,17 @@
+#pragma once
+
+// Host build configuration: the shipped example plus the settings it does
+// not define. CMakeLists.txt stages this next to the sketch, so a local
+// MQTTDisplay/config.h with real credentials is never picked up.
+
+#include "config_example.h"
+
+const unsigned long DISPLAY_REFRESH_MS = 16;
+const unsigned long MQTT_TRY_INTERVAL_MS = 2000;
+const unsigned long MQTT_CONNECT_TIMEOUT_MS = 5000;
+
+#define USE_STATIC_IP 0
+const IPAddress WIFI_STATIC_IP(192, 168, 1, 50);
+const IPAddress WIFI_DNS(192, 168, 1, 1);
+const IPAddress WIFI_GATEWAY(192, 168, 1, 1);
+const IPAddress WIFI_SUBNET(255, 255, 255, 0);
@@ -0,0 +1,133 @@
+#pragma once
+
+// Host stand-in for the Arduino core: the subset of the API the firmware
+// uses, backed by the virtual clock and buffers in host_hal.cpp. Deliberately
+// does not define ARDUINO_ARCH_RENESAS, so board-only paths (WFI, DWT,
+// NVIC_SystemReset) take their portable branches.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#define PROGMEM
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define LED_BUILTIN 13
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+long random(long maxValue);
+long random(long minValue, long maxValue);
+void randomSeed(unsigned long seed);
+
+template <class T, class L, class H>
+T constrain(T v, L lo, H hi) {
+  return v < lo ? (T)lo : (v > hi ? (T)hi : v);
+}
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  const char* c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool operator==(const char* s) const { return s_ == s; }
+
+ private:
+  std::string s_;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    size_t written = 0;
+    while (n--) written += write(*buf++);
+    return written;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return printUnsigned(v, base); }
+  size_t print(int v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned int v, int base = DEC) { return printUnsigned(v, base); }
+  size_t print(long v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned long v, int base = DEC) { return printUnsigned(v, base); }
+  size_t print(long long v, int base = DEC) { return printSigned(v, base); }
+  size_t print(unsigned long long v, int base = DEC) { return printUnsigned(v, base); }
+  size_t print(double v, int digits = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return write(buf);
+  }
+
+  template <class T>
+  size_t println(const T& v) {
+    size_t n = print(v);
+    return n + println();
+  }
+  template <class T>
+  size_t println(const T& v, int format) {
+    size_t n = print(v, format);
+    return n + println();
+  }
+  size_t println() { return write("\r\n"); }
+
+ private:
+  size_t printUnsigned(unsigned long long v, int base) {
+    char buf[72];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    if (base < 2) base = DEC;
+    do {
+      int d = (int)(v % (unsigned)base);
+      *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+      v /= (unsigned)base;
+    } while (v);
+    return write(p);
+  }
+  size_t printSigned(long long v, int base) {
+    if (base != DEC || v >= 0) return printUnsigned((unsigned long long)v, base);
+    return write((uint8_t)'-') + printUnsigned(0ULL - (unsigned long long)v, base);
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// Output is captured for the tests (host::serialOutput); input is queued
+// with host::serialInput.
+class HostSerial : public Stream {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  operator bool() const { return true; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+};
+
+extern HostSerial Serial;
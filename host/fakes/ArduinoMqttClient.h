@@ -0,0 +1,73 @@
+#pragma once
+
+// ArduinoMqttClient's interface on top of host::broker(). poll() hands over
+// at most one message per call, the way the library reads one packet per
+// call; stop() is a graceful DISCONNECT, while closing the underlying
+// WiFiClient is not and makes the broker publish the will.
+
+#include <string>
+
+#include "Arduino.h"
+#include "WiFiS3.h"
+#include "host_hal.h"
+
+#define MQTT_CONNECTION_REFUSED -2
+#define MQTT_CONNECTION_TIMEOUT -1
+#define MQTT_SUCCESS 0
+
+class MqttClient : public Client {
+ public:
+  MqttClient(Client& client) : client_(&client) {}
+  MqttClient(Client* client) : client_(client) {}
+
+  void onMessage(void (*callback)(int)) { onMessage_ = callback; }
+  void setId(const char* id) { id_ = id; }
+  void setUsernamePassword(const char* user, const char* pass);
+  void setCleanSession(bool clean) { clean_ = clean; }
+  void setKeepAliveInterval(unsigned long ms) { (void)ms; }
+  void setConnectionTimeout(unsigned long ms) { (void)ms; }
+  void setTxPayloadSize(unsigned short size) { (void)size; }
+
+  int connect(const char* host, uint16_t port = 1883) override;
+  uint8_t connected() override;
+  void stop() override;
+  int connectError() const { return connectError_; }
+  int subscribe(const char* topic, uint8_t qos = 0);
+  void poll();
+
+  int beginWill(const char* topic, bool retain, uint8_t qos);
+  int endWill();
+  int beginMessage(const char* topic, bool retain = false, uint8_t qos = 0, bool dup = false);
+  int endMessage();
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // The message being delivered to the onMessage callback.
+  String messageTopic() const { return String(rx_.topic); }
+  int messageDup() const { return rx_.dup; }
+  int messageQoS() const { return rx_.qos; }
+  int messageRetain() const { return rx_.retain; }
+  int messageSize() const { return (int)rx_.payload.size(); }
+  int available() override { return (int)(rx_.payload.size() - rxPos_); }
+  int read() override;
+  int peek() override;
+
+ private:
+  enum TxMode : uint8_t { TX_NONE, TX_MESSAGE, TX_WILL };
+
+  Client* client_;
+  void (*onMessage_)(int) = nullptr;
+  std::string id_ = "arduino";
+  bool clean_ = true;
+  bool sessionUp_ = false;
+  uint32_t connId_ = 0;
+  int connectError_ = MQTT_SUCCESS;
+
+  TxMode txMode_ = TX_NONE;
+  host::MqttMessage tx_;
+  bool hasWill_ = false;
+  host::MqttMessage will_;
+
+  host::MqttMessage rx_;
+  size_t rxPos_ = 0;
+};
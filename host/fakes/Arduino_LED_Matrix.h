@@ -0,0 +1,12 @@
+#pragma once
+
+// Headless matrix: loaded frames are recorded in host::matrix().
+
+#include "Arduino.h"
+
+class ArduinoLEDMatrix {
+ public:
+  bool begin();
+  void end();
+  void loadFrame(const uint32_t buffer[3]);
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+// In-memory EEPROM of host::EEPROM_SIZE bytes, erased to 0xFF at start.
+// Out-of-range accesses abort, which the board would not do for you.
+
+#include "Arduino.h"
+#include "host_hal.h"
+
+class EEPROMClass {
+ public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t value);
+  void update(int idx, uint8_t value);
+  uint16_t length() { return (uint16_t)host::EEPROM_SIZE; }
+
+  template <class T>
+  T& get(int idx, T& t) {
+    check(idx, sizeof(T));
+    memcpy(&t, host::eepromData() + idx, sizeof(T));
+    return t;
+  }
+
+  template <class T>
+  const T& put(int idx, const T& t) {
+    check(idx, sizeof(T));
+    const uint8_t* p = (const uint8_t*)&t;
+    for (size_t i = 0; i < sizeof(T); i++) update(idx + (int)i, p[i]);
+    return t;
+  }
+
+ private:
+  static void check(int idx, size_t len);
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : b_{a, b, c, d} {}
+  IPAddress(uint32_t v) {
+    for (int i = 0; i < 4; i++) b_[i] = (uint8_t)(v >> (8 * i));
+  }
+
+  operator uint32_t() const {
+    return (uint32_t)b_[0] | ((uint32_t)b_[1] << 8) | ((uint32_t)b_[2] << 16) | ((uint32_t)b_[3] << 24);
+  }
+  uint8_t operator[](int i) const { return b_[i]; }
+  uint8_t& operator[](int i) { return b_[i]; }
+  bool operator==(const IPAddress& o) const { return (uint32_t)*this == (uint32_t)o; }
+  bool operator!=(const IPAddress& o) const { return !(*this == o); }
+
+ private:
+  uint8_t b_[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+// Scripted WiFiS3: joins, link drops and DNS timing come from host::wifi().
+// WiFi.begin() returns at once and status() turns WL_CONNECTED after the
+// scripted join time; hostByName() blocks like the real AT round trip.
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+};
+
+class Client : public Stream {
+ public:
+  virtual int connect(const char* host, uint16_t port) = 0;
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+};
+
+// TCP socket to the broker stand-in. Payload bytes never pass through it;
+// the MqttClient fake talks to host::broker() directly and only uses the
+// socket for link state.
+class WiFiClient : public Client {
+ public:
+  ~WiFiClient() override;
+  int connect(const char* host, uint16_t port) override;
+  uint8_t connected() override;
+  void stop() override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+ private:
+  bool open_ = false;
+  uint32_t linkEpoch_ = 0;
+};
+
+class WiFiClass {
+ public:
+  int status();
+  int begin(const char* ssid, const char* pass);
+  void config(IPAddress ip);
+  void config(IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet);
+  void disconnect();
+  int hostByName(const char* host, IPAddress& result);
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(int n = 0);
+  uint8_t* macAddress(uint8_t* mac);
+};
+
+extern WiFiClass WiFi;
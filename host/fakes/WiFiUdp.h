@@ -0,0 +1,44 @@
+#pragma once
+
+// UDP over the fake link. Datagrams go to the responder registered for the
+// destination port (see host::setUdpResponder); its reply is queued on this
+// socket and becomes readable after the responder's delay.
+
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiUDP : public Stream {
+ public:
+  uint8_t begin(uint16_t port);
+  void stop();
+  int beginPacket(IPAddress ip, uint16_t port);
+  int beginPacket(const char* host, uint16_t port);
+  int endPacket();
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+  int parsePacket();
+  int read() override;
+  int read(uint8_t* buf, size_t n);
+  int read(char* buf, size_t n) { return read((uint8_t*)buf, n); }
+  int available() override;
+  int peek() override;
+  void flush() {}
+
+ private:
+  struct Datagram {
+    uint64_t readyUs;
+    std::vector<uint8_t> data;
+  };
+  bool open_ = false;
+  bool sending_ = false;
+  IPAddress dest_;
+  uint16_t destPort_ = 0;
+  std::vector<uint8_t> tx_;
+  std::deque<Datagram> rx_;
+  std::vector<uint8_t> cur_;
+  size_t curPos_ = 0;
+};
@@ -0,0 +1,320 @@
+#include <ArduinoMqttClient.h>
+
+#include "host_hal.h"
+
+namespace host {
+
+Broker& broker() {
+  // Never destroyed: sockets in static objects report to it on teardown.
+  static Broker* instance = new Broker();
+  return *instance;
+}
+
+bool topicMatches(const std::string& filter, const std::string& topic) {
+  size_t f = 0;
+  size_t t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+      continue;
+    }
+    if (t >= topic.size() || filter[f] != topic[t]) return false;
+    f++;
+    t++;
+  }
+  return t == topic.size();
+}
+
+void Broker::publish(const std::string& topic, const std::string& payload, uint8_t qos, bool retain) {
+  MqttMessage m;
+  m.topic = topic;
+  m.payload = payload;
+  m.qos = qos;
+  m.retain = retain;
+  route(m);
+}
+
+void Broker::dropClients() {
+  for (auto& entry : sessions_) {
+    if (entry.second.connected) closeSession(entry.second, false);
+  }
+}
+
+void Broker::stop() {
+  up_ = false;
+  for (auto& entry : sessions_) {
+    if (entry.second.connected) closeSession(entry.second, true);
+  }
+}
+
+void Broker::start() {
+  up_ = true;
+}
+
+bool Broker::clientConnected() const {
+  for (const auto& entry : sessions_) {
+    if (entry.second.connected) return true;
+  }
+  return false;
+}
+
+size_t Broker::queued() const {
+  size_t n = 0;
+  for (const auto& entry : sessions_) n += entry.second.inbox.size();
+  return n;
+}
+
+bool Broker::subscribed(const std::string& topic) const {
+  for (const auto& entry : sessions_) {
+    for (const auto& sub : entry.second.subs) {
+      if (topicMatches(sub.first, topic)) return true;
+    }
+  }
+  return false;
+}
+
+const MqttMessage* Broker::lastPublished(const std::string& topic) const {
+  for (auto it = published.rbegin(); it != published.rend(); ++it) {
+    if (it->topic == topic) return &*it;
+  }
+  return nullptr;
+}
+
+unsigned long Broker::countPublished(const std::string& topic, const std::string& payload) const {
+  unsigned long n = 0;
+  for (const MqttMessage& m : published) n += m.topic == topic && m.payload == payload;
+  return n;
+}
+
+bool Broker::connect(const std::string& id, bool clean, const void* socket, const MqttMessage* will,
+                     uint32_t& connId) {
+  if (!up_) {
+    refused++;
+    return false;
+  }
+  Session& s = sessions_[id];
+  // A second connection with the same id takes the session over.
+  if (s.connected) closeSession(s, false);
+  if (clean) s = Session();
+  s.clean = clean;
+  s.connected = true;
+  s.connId = connId = nextConnId_++;
+  s.socket = socket;
+  s.hasWill = will != nullptr;
+  if (will) s.will = *will;
+  connects++;
+  lastClientId = id;
+  return true;
+}
+
+void Broker::disconnect(const std::string& id, uint32_t connId, bool graceful) {
+  auto it = sessions_.find(id);
+  if (it == sessions_.end() || !it->second.connected || it->second.connId != connId) return;
+  closeSession(it->second, graceful);
+}
+
+void Broker::socketClosed(const void* socket) {
+  for (auto& entry : sessions_) {
+    if (entry.second.connected && entry.second.socket == socket) closeSession(entry.second, false);
+  }
+}
+
+bool Broker::isConnected(const std::string& id, uint32_t connId) const {
+  auto it = sessions_.find(id);
+  return it != sessions_.end() && it->second.connected && it->second.connId == connId;
+}
+
+uint8_t Broker::subscribe(const std::string& id, const std::string& filter, uint8_t qos) {
+  auto it = sessions_.find(id);
+  if (it == sessions_.end() || !it->second.connected) return 0x80;
+  Session& s = it->second;
+  uint8_t granted = qos > 1 ? 1 : qos;
+  s.subs[filter] = granted;
+  for (const auto& r : retained) {
+    if (!topicMatches(filter, r.first)) continue;
+    MqttMessage m;
+    m.topic = r.first;
+    m.payload = r.second;
+    m.qos = granted;
+    m.retain = true;
+    s.inbox.push_back(m);
+  }
+  return granted;
+}
+
+bool Broker::nextMessage(const std::string& id, MqttMessage& out) {
+  auto it = sessions_.find(id);
+  if (it == sessions_.end() || !it->second.connected || it->second.inbox.empty()) return false;
+  Session& s = it->second;
+  out = s.inbox.front();
+  s.inbox.pop_front();
+  if (out.qos > 0 && lostAcks_ > 0) {
+    s.unacked.push_back(out);
+    lostAcks_--;
+  }
+  delivered++;
+  // Last: the clock hook may publish, which touches the inboxes.
+  if (deliveryCostUs) advanceUs(deliveryCostUs);
+  return true;
+}
+
+void Broker::clientPublish(const MqttMessage& m) {
+  published.push_back(m);
+  route(m);
+}
+
+void Broker::route(const MqttMessage& m) {
+  if (m.retain) {
+    if (m.payload.empty()) retained.erase(m.topic);
+    else retained[m.topic] = m.payload;
+  }
+  for (auto& entry : sessions_) {
+    Session& s = entry.second;
+    if (!s.connected && s.clean) continue;
+    for (const auto& sub : s.subs) {
+      if (!topicMatches(sub.first, m.topic)) continue;
+      uint8_t qos = m.qos < sub.second ? m.qos : sub.second;
+      // An absent client only gets what its session queues: QoS1.
+      if (s.connected || qos > 0) {
+        MqttMessage copy = m;
+        copy.qos = qos;
+        copy.retain = false;
+        copy.dup = false;
+        s.inbox.push_back(copy);
+      }
+      break;
+    }
+  }
+}
+
+void Broker::closeSession(Session& s, bool graceful) {
+  s.connected = false;
+  s.socket = nullptr;
+  if (!graceful && s.hasWill) {
+    willsSent++;
+    clientPublish(s.will);
+  }
+  if (s.clean) {
+    s = Session();
+    return;
+  }
+  for (auto it = s.inbox.begin(); it != s.inbox.end();) {
+    if (it->qos == 0) it = s.inbox.erase(it);
+    else ++it;
+  }
+  // Unacknowledged QoS1 messages go out again first on the next connection.
+  while (!s.unacked.empty()) {
+    MqttMessage m = s.unacked.back();
+    s.unacked.pop_back();
+    m.dup = true;
+    s.inbox.push_front(m);
+    redelivered++;
+  }
+}
+
+}  // namespace host
+
+void MqttClient::setUsernamePassword(const char* user, const char* pass) {
+  (void)user;
+  (void)pass;
+}
+
+int MqttClient::connect(const char* host, uint16_t port) {
+  stop();
+  if (!client_->connect(host, port)) {
+    connectError_ = MQTT_CONNECTION_REFUSED;
+    return 0;
+  }
+  if (!host::broker().connect(id_, clean_, client_, hasWill_ ? &will_ : nullptr, connId_)) {
+    client_->stop();
+    connectError_ = MQTT_CONNECTION_REFUSED;
+    return 0;
+  }
+  sessionUp_ = true;
+  connectError_ = MQTT_SUCCESS;
+  return 1;
+}
+
+uint8_t MqttClient::connected() {
+  if (!sessionUp_) return 0;
+  if (client_->connected() && host::broker().isConnected(id_, connId_)) return 1;
+  // Whichever side went away first, this connection is over.
+  sessionUp_ = false;
+  client_->stop();
+  return 0;
+}
+
+void MqttClient::stop() {
+  if (sessionUp_) host::broker().disconnect(id_, connId_, true);
+  sessionUp_ = false;
+  client_->stop();
+}
+
+int MqttClient::subscribe(const char* topic, uint8_t qos) {
+  if (!connected()) return 0;
+  return host::broker().subscribe(id_, topic, qos) != 0x80;
+}
+
+void MqttClient::poll() {
+  if (!connected()) return;
+  host::MqttMessage m;
+  if (!host::broker().nextMessage(id_, m)) return;
+  rx_ = m;
+  rxPos_ = 0;
+  if (onMessage_) onMessage_((int)rx_.payload.size());
+  // Whatever the callback left unread is skipped, as in the library.
+  rx_ = host::MqttMessage();
+  rxPos_ = 0;
+}
+
+int MqttClient::beginWill(const char* topic, bool retain, uint8_t qos) {
+  will_ = host::MqttMessage();
+  will_.topic = topic;
+  will_.retain = retain;
+  will_.qos = qos;
+  txMode_ = TX_WILL;
+  return 1;
+}
+
+int MqttClient::endWill() {
+  if (txMode_ != TX_WILL) return 0;
+  txMode_ = TX_NONE;
+  hasWill_ = true;
+  return 1;
+}
+
+int MqttClient::beginMessage(const char* topic, bool retain, uint8_t qos, bool dup) {
+  if (!connected()) return 0;
+  tx_ = host::MqttMessage();
+  tx_.topic = topic;
+  tx_.retain = retain;
+  tx_.qos = qos;
+  tx_.dup = dup;
+  txMode_ = TX_MESSAGE;
+  return 1;
+}
+
+int MqttClient::endMessage() {
+  if (txMode_ != TX_MESSAGE) return 0;
+  txMode_ = TX_NONE;
+  if (!connected()) return 0;
+  host::broker().clientPublish(tx_);
+  return 1;
+}
+
+size_t MqttClient::write(uint8_t c) {
+  if (txMode_ == TX_MESSAGE) tx_.payload += (char)c;
+  else if (txMode_ == TX_WILL) will_.payload += (char)c;
+  else return 0;
+  return 1;
+}
+
+int MqttClient::read() {
+  return rxPos_ < rx_.payload.size() ? (uint8_t)rx_.payload[rxPos_++] : -1;
+}
+
+int MqttClient::peek() {
+  return rxPos_ < rx_.payload.size() ? (uint8_t)rx_.payload[rxPos_] : -1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// The slice of ezTime the firmware uses: zone rules only. There is no
+// timezoned server on the host, so setLocation() fails and the POSIX rule
+// fallback (std offset, dst offset, two Mm.w.d/h transitions) is evaluated
+// here instead.
+
+#include <time.h>
+
+#include "Arduino.h"
+
+typedef enum { LOCAL_TIME, UTC_TIME } ezLocalOrUTC_t;
+
+class Timezone {
+ public:
+  bool setCache(int16_t address);
+  bool setLocation(const String location = "");
+  bool setPosix(const String posix);
+  String getPosix() { return String(posix_); }
+  void setDefault() {}
+  // Local time for a UTC time_t; a local time_t is returned unchanged.
+  time_t tzTime(time_t t, ezLocalOrUTC_t localOrUtc = LOCAL_TIME);
+
+ private:
+  struct Rule {
+    int month;
+    int week;
+    int weekday;
+    long secOfDay;
+  };
+  long offsetAt(time_t utc) const;
+  static time_t transitionUtc(int year, const Rule& r, long offset);
+
+  std::string posix_;
+  long stdOffset_ = 0;  // local minus UTC, seconds
+  long dstOffset_ = 0;
+  bool hasDst_ = false;
+  Rule start_ = {};
+  Rule end_ = {};
+};
+
+inline void events() {}
+inline void setInterval(uint16_t seconds = 0) { (void)seconds; }
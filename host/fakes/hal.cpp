@@ -0,0 +1,351 @@
+#include <Arduino.h>
+#include <Arduino_LED_Matrix.h>
+#include <EEPROM.h>
+#include <ezTime.h>
+
+#include <chrono>
+
+#include "host_hal.h"
+
+HostSerial Serial;
+EEPROMClass EEPROM;
+
+namespace {
+
+uint64_t clockUs = 0;
+uint64_t sleptTotalUs = 0;
+bool wallClock = false;
+std::chrono::steady_clock::time_point wallStart;
+std::function<void()> idleHook;
+bool inIdleHook = false;
+
+std::string serialOut;
+std::string serialIn;
+bool serialEcho = false;
+
+int pins[64];
+
+uint8_t eeprom[host::EEPROM_SIZE];
+bool eepromReady = false;
+unsigned long eepromWriteCount = 0;
+
+host::MatrixLog matrixLog;
+
+uint32_t randomState = 1;
+
+void ensureEeprom() {
+  if (eepromReady) return;
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  eepromReady = true;
+}
+
+uint64_t wallElapsedUs() {
+  if (!wallClock) return 0;
+  auto elapsed = std::chrono::steady_clock::now() - wallStart;
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+}  // namespace
+
+namespace host {
+
+uint64_t nowUs() {
+  return clockUs + wallElapsedUs();
+}
+
+void advanceUs(uint64_t us) {
+  clockUs += us;
+  // The hook may publish or reply, but must not recurse through delay().
+  if (idleHook && !inIdleHook) {
+    inIdleHook = true;
+    idleHook();
+    inIdleHook = false;
+  }
+}
+
+void advanceMs(unsigned long ms) {
+  advanceUs((uint64_t)ms * 1000);
+}
+
+void setIdleHook(std::function<void()> hook) {
+  idleHook = hook;
+}
+
+uint64_t sleptUs() {
+  return sleptTotalUs;
+}
+
+void setWallClock(bool on) {
+  // Fold the real time that passed into the virtual clock, so it never
+  // steps backwards when the mode changes.
+  clockUs += wallElapsedUs();
+  wallClock = on;
+  wallStart = std::chrono::steady_clock::now();
+}
+
+void serialInput(const std::string& text) {
+  serialIn += text;
+}
+
+const std::string& serialOutput() {
+  return serialOut;
+}
+
+void clearSerialOutput() {
+  serialOut.clear();
+}
+
+void setSerialEcho(bool on) {
+  serialEcho = on;
+}
+
+int pinLevel(int pin) {
+  return pin >= 0 && pin < 64 ? pins[pin] : LOW;
+}
+
+uint8_t* eepromData() {
+  ensureEeprom();
+  return eeprom;
+}
+
+unsigned long eepromWrites() {
+  return eepromWriteCount;
+}
+
+const MatrixLog& matrix() {
+  return matrixLog;
+}
+
+bool matrixPixel(int x, int y) {
+  int i = y * 12 + x;
+  return (matrixLog.frame[i / 32] >> (31 - i % 32)) & 1;
+}
+
+int matrixLitPixels() {
+  int n = 0;
+  for (uint32_t w : matrixLog.frame) n += __builtin_popcount(w);
+  return n;
+}
+
+}  // namespace host
+
+unsigned long millis() {
+  return (unsigned long)(host::nowUs() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)host::nowUs();
+}
+
+void delay(unsigned long ms) {
+  sleptTotalUs += (uint64_t)ms * 1000;
+  host::advanceMs(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+  sleptTotalUs += us;
+  host::advanceUs(us);
+}
+
+void pinMode(int pin, int mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(int pin, int value) {
+  if (pin >= 0 && pin < 64) pins[pin] = value;
+}
+
+int digitalRead(int pin) {
+  return host::pinLevel(pin);
+}
+
+// xorshift32: deterministic across runs, which the tests rely on.
+long random(long maxValue) {
+  if (maxValue <= 0) return 0;
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (long)(randomState % (uint32_t)maxValue);
+}
+
+long random(long minValue, long maxValue) {
+  if (maxValue <= minValue) return minValue;
+  return minValue + random(maxValue - minValue);
+}
+
+void randomSeed(unsigned long seed) {
+  randomState = seed ? (uint32_t)seed : 1;
+}
+
+size_t HostSerial::write(uint8_t c) {
+  serialOut += (char)c;
+  if (serialEcho) fputc(c, stdout);
+  return 1;
+}
+
+int HostSerial::available() {
+  return (int)serialIn.size();
+}
+
+int HostSerial::read() {
+  if (serialIn.empty()) return -1;
+  int c = (uint8_t)serialIn[0];
+  serialIn.erase(0, 1);
+  return c;
+}
+
+int HostSerial::peek() {
+  return serialIn.empty() ? -1 : (uint8_t)serialIn[0];
+}
+
+void EEPROMClass::check(int idx, size_t len) {
+  if (idx >= 0 && (size_t)idx + len <= host::EEPROM_SIZE) return;
+  fprintf(stderr, "EEPROM access out of range: %d+%zu\n", idx, len);
+  abort();
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  check(idx, 1);
+  return host::eepromData()[idx];
+}
+
+void EEPROMClass::write(int idx, uint8_t value) {
+  check(idx, 1);
+  host::eepromData()[idx] = value;
+  eepromWriteCount++;
+}
+
+void EEPROMClass::update(int idx, uint8_t value) {
+  if (read(idx) != value) write(idx, value);
+}
+
+bool ArduinoLEDMatrix::begin() {
+  matrixLog.running = true;
+  matrixLog.begins++;
+  return true;
+}
+
+void ArduinoLEDMatrix::end() {
+  matrixLog.running = false;
+}
+
+void ArduinoLEDMatrix::loadFrame(const uint32_t buffer[3]) {
+  memcpy(matrixLog.frame, buffer, sizeof(matrixLog.frame));
+  matrixLog.loads++;
+  matrixLog.lastLoadUs = clockUs;
+}
+
+// --- ezTime ------------------------------------------------------------------
+
+bool Timezone::setCache(int16_t address) {
+  (void)address;
+  return false;
+}
+
+bool Timezone::setLocation(const String location) {
+  (void)location;
+  return false;
+}
+
+static bool parseName(const char*& p) {
+  const char* start = p;
+  if (*p == '<') {
+    while (*p && *p != '>') p++;
+    if (*p != '>') return false;
+    p++;
+    return true;
+  }
+  while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z')) p++;
+  return p - start >= 3;
+}
+
+// [+|-]hh[:mm[:ss]], returned in seconds.
+static bool parseClock(const char*& p, long& sec) {
+  int sign = 1;
+  if (*p == '+' || *p == '-') sign = *p++ == '-' ? -1 : 1;
+  if (*p < '0' || *p > '9') return false;
+  long parts[3] = {0, 0, 0};
+  for (int i = 0; i < 3; i++) {
+    parts[i] = strtol(p, (char**)&p, 10);
+    if (*p != ':') break;
+    p++;
+  }
+  sec = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+  return true;
+}
+
+bool Timezone::setPosix(const String posix) {
+  const char* p = posix.c_str();
+  long stdSec = 0;
+  if (!parseName(p) || !parseClock(p, stdSec)) return false;
+  // POSIX offsets are west-positive; store local minus UTC.
+  stdOffset_ = -stdSec;
+  dstOffset_ = stdOffset_;
+  hasDst_ = false;
+  if (*p) {
+    if (!parseName(p)) return false;
+    dstOffset_ = stdOffset_ + 3600;
+    if (*p && *p != ',') {
+      long dstSec = 0;
+      if (!parseClock(p, dstSec)) return false;
+      dstOffset_ = -dstSec;
+    }
+    Rule* rules[2] = {&start_, &end_};
+    for (Rule* r : rules) {
+      if (*p++ != ',' || *p++ != 'M') return false;
+      r->month = (int)strtol(p, (char**)&p, 10);
+      if (*p++ != '.') return false;
+      r->week = (int)strtol(p, (char**)&p, 10);
+      if (*p++ != '.') return false;
+      r->weekday = (int)strtol(p, (char**)&p, 10);
+      r->secOfDay = 7200;
+      if (*p == '/') {
+        p++;
+        if (!parseClock(p, r->secOfDay)) return false;
+      }
+    }
+    hasDst_ = true;
+  }
+  if (*p) return false;
+  posix_ = posix.c_str();
+  return true;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date.
+static long daysFromCivil(int y, int m, int d) {
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+time_t Timezone::transitionUtc(int year, const Rule& r, long offset) {
+  static const int DAYS_IN_MONTH[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  int dim = DAYS_IN_MONTH[r.month - 1];
+  if (r.month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) dim = 29;
+  long first = daysFromCivil(year, r.month, 1);
+  int firstWeekday = (int)((first % 7 + 11) % 7);  // 1970-01-01 was a Thursday
+  int day = 1 + (r.weekday - firstWeekday + 7) % 7 + (r.week - 1) * 7;
+  while (day > dim) day -= 7;
+  return (time_t)(daysFromCivil(year, r.month, day) * 86400L + r.secOfDay - offset);
+}
+
+long Timezone::offsetAt(time_t utc) const {
+  if (!hasDst_) return stdOffset_;
+  struct tm parts;
+  gmtime_r(&utc, &parts);
+  int year = parts.tm_year + 1900;
+  // The start is given in standard time, the end in daylight time.
+  time_t start = transitionUtc(year, start_, stdOffset_);
+  time_t end = transitionUtc(year, end_, dstOffset_);
+  bool dst = start < end ? (utc >= start && utc < end) : (utc >= start || utc < end);
+  return dst ? dstOffset_ : stdOffset_;
+}
+
+time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t localOrUtc) {
+  if (localOrUtc != UTC_TIME) return t;
+  return t + offsetAt(t);
+}
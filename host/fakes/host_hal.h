@@ -0,0 +1,175 @@
+#pragma once
+
+// Test-side controls for the host fakes. The firmware only sees the
+// Arduino-shaped headers in this directory; tests move the clock, script
+// the network and the broker, and read back what the sketch did through
+// the functions here. Every executable is one fresh board, so nothing here
+// needs resetting between tests.
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "IPAddress.h"
+
+class MqttClient;
+
+namespace host {
+
+// --- Clock ---------------------------------------------------------------
+// millis()/micros() read a virtual clock that only moves through delay()
+// and advance*(), so a test runs hours of firmware time in milliseconds and
+// every run is the same. The idle hook runs after each step of the clock;
+// tests use it to feed traffic while the sketch sleeps in delay().
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+void advanceMs(unsigned long ms);
+void setIdleHook(std::function<void()> hook);
+// While on, the clock also follows the host's steady clock, so micros()
+// around a block of code measures how long it really took (benchmarks).
+void setWallClock(bool on);
+// Virtual time spent in delay()/delayMicroseconds(); the rest of a loop
+// pass is busy time.
+uint64_t sleptUs();
+
+// --- Serial and pins -------------------------------------------------------
+void serialInput(const std::string& text);
+const std::string& serialOutput();
+void clearSerialOutput();
+// Copies everything the sketch prints to stdout as well.
+void setSerialEcho(bool on);
+int pinLevel(int pin);
+
+// --- EEPROM ----------------------------------------------------------------
+const size_t EEPROM_SIZE = 8192;
+uint8_t* eepromData();
+// Bytes actually changed by write()/update(), a stand-in for flash wear.
+unsigned long eepromWrites();
+
+// --- LED matrix --------------------------------------------------------------
+struct MatrixLog {
+  bool running = false;
+  unsigned long begins = 0;
+  unsigned long loads = 0;
+  uint32_t frame[3] = {0, 0, 0};
+  uint64_t lastLoadUs = 0;
+};
+const MatrixLog& matrix();
+// Pixel of the last loaded frame, in the loadFrame bit layout.
+bool matrixPixel(int x, int y);
+int matrixLitPixels();
+
+// --- WiFi ------------------------------------------------------------------
+// WiFi.begin() joins after joinMs while the access point is up. Dropping
+// the access point closes every open socket without a FIN reaching the
+// broker's side first, just like walking out of range.
+struct WifiScript {
+  bool apUp = true;
+  unsigned long joinMs = 1500;
+  unsigned long dnsMs = 30;  // WiFi.hostByName blocks this long
+  bool dnsOk = true;
+  IPAddress localIp = IPAddress(192, 168, 1, 77);
+};
+struct WifiStats {
+  unsigned long begins = 0;
+  unsigned long dnsLookups = 0;
+  unsigned long configs = 0;
+};
+WifiScript& wifi();
+const WifiStats& wifiStats();
+void setAccessPoint(bool up);
+bool wifiLinkUp();
+// What hostByName resolves host to (a fixed address derived from the name).
+IPAddress resolvedAddress(const char* host);
+
+// Answers a datagram sent to port: return false to drop it, otherwise fill
+// reply and how long after the send it can be read.
+typedef std::function<bool(const IPAddress& dest, const std::vector<uint8_t>& request,
+                           std::vector<uint8_t>& reply, uint64_t& delayUs)> UdpResponder;
+void setUdpResponder(uint16_t port, UdpResponder responder);
+
+// --- MQTT broker -------------------------------------------------------------
+struct MqttMessage {
+  std::string topic;
+  std::string payload;
+  uint8_t qos = 0;
+  bool retain = false;
+  bool dup = false;
+};
+
+// In-process stand-in for a broker, reached through the MqttClient fake.
+// Topics match exactly or through '+' and '#' filters. Sessions without
+// clean start keep their subscriptions and queue QoS1 messages while the
+// client is away.
+class Broker {
+ public:
+  // Publishes as another client would.
+  void publish(const std::string& topic, const std::string& payload, uint8_t qos = 1, bool retain = false);
+  // Closes every client socket without DISCONNECT; wills are published.
+  void dropClients();
+  // The broker process goes away: connections are cut and refused until
+  // start(). Retained messages and persistent sessions survive; no will is
+  // published, since nobody is left to publish it.
+  void stop();
+  void start();
+  // The client's acks for the next n QoS1 deliveries get lost. When that
+  // connection ends they are sent again, with DUP set.
+  void loseAcks(unsigned long n) { lostAcks_ += n; }
+
+  // Virtual time the client spends reading and decoding each delivery.
+  uint64_t deliveryCostUs = 0;
+
+  bool up() const { return up_; }
+  bool clientConnected() const;
+  size_t queued() const;
+  bool subscribed(const std::string& topic) const;
+  // Last message a client published on topic, or nullptr.
+  const MqttMessage* lastPublished(const std::string& topic) const;
+  unsigned long countPublished(const std::string& topic, const std::string& payload) const;
+
+  std::vector<MqttMessage> published;  // from clients, wills included
+  std::map<std::string, std::string> retained;
+  unsigned long connects = 0;
+  unsigned long refused = 0;
+  unsigned long delivered = 0;
+  unsigned long willsSent = 0;
+  unsigned long redelivered = 0;
+  std::string lastClientId;
+
+  // Used by the MqttClient fake.
+  struct Session {
+    bool connected = false;
+    bool clean = true;
+    uint32_t connId = 0;
+    const void* socket = nullptr;
+    std::map<std::string, uint8_t> subs;
+    std::deque<MqttMessage> inbox;
+    std::deque<MqttMessage> unacked;
+    bool hasWill = false;
+    MqttMessage will;
+  };
+  bool connect(const std::string& id, bool clean, const void* socket, const MqttMessage* will, uint32_t& connId);
+  void disconnect(const std::string& id, uint32_t connId, bool graceful);
+  void socketClosed(const void* socket);
+  bool isConnected(const std::string& id, uint32_t connId) const;
+  uint8_t subscribe(const std::string& id, const std::string& filter, uint8_t qos);
+  bool nextMessage(const std::string& id, MqttMessage& out);
+  void clientPublish(const MqttMessage& m);
+
+ private:
+  void route(const MqttMessage& m);
+  void closeSession(Session& s, bool graceful);
+
+  bool up_ = true;
+  uint32_t nextConnId_ = 1;
+  unsigned long lostAcks_ = 0;
+  std::map<std::string, Session> sessions_;
+};
+
+Broker& broker();
+bool topicMatches(const std::string& filter, const std::string& topic);
+
+}  // namespace host
@@ -0,0 +1,226 @@
+#include <WiFiS3.h>
+#include <WiFiUdp.h>
+
+#include "host_hal.h"
+
+WiFiClass WiFi;
+
+namespace {
+
+host::WifiScript script;
+host::WifiStats stats;
+bool joining = false;
+uint64_t joinAtUs = 0;
+// Bumped whenever the link goes down; sockets opened before are dead.
+uint32_t linkEpoch = 1;
+std::map<uint16_t, host::UdpResponder> udpResponders;
+
+}  // namespace
+
+namespace host {
+
+WifiScript& wifi() {
+  return script;
+}
+
+const WifiStats& wifiStats() {
+  return stats;
+}
+
+bool wifiLinkUp() {
+  return script.apUp && joining && nowUs() >= joinAtUs;
+}
+
+void setAccessPoint(bool up) {
+  if (script.apUp && !up) {
+    joining = false;
+    linkEpoch++;
+    broker().dropClients();
+  }
+  script.apUp = up;
+}
+
+IPAddress resolvedAddress(const char* host) {
+  uint32_t h = 2166136261UL;
+  while (*host) h = (h ^ (uint8_t)*host++) * 16777619UL;
+  return IPAddress(10, (uint8_t)(h >> 16), (uint8_t)(h >> 8), (uint8_t)(h | 1));
+}
+
+void setUdpResponder(uint16_t port, UdpResponder responder) {
+  udpResponders[port] = responder;
+}
+
+}  // namespace host
+
+int WiFiClass::status() {
+  if (host::wifiLinkUp()) return WL_CONNECTED;
+  return joining ? WL_IDLE_STATUS : WL_DISCONNECTED;
+}
+
+int WiFiClass::begin(const char* ssid, const char* pass) {
+  (void)ssid;
+  (void)pass;
+  stats.begins++;
+  joining = script.apUp;
+  joinAtUs = host::nowUs() + (uint64_t)script.joinMs * 1000;
+  return status();
+}
+
+void WiFiClass::config(IPAddress ip) {
+  (void)ip;
+  stats.configs++;
+}
+
+void WiFiClass::config(IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet) {
+  (void)dns;
+  (void)gateway;
+  (void)subnet;
+  config(ip);
+}
+
+void WiFiClass::disconnect() {
+  if (joining) linkEpoch++;
+  joining = false;
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+  stats.dnsLookups++;
+  host::advanceMs(script.dnsMs);
+  if (!host::wifiLinkUp() || !script.dnsOk) return 0;
+  result = host::resolvedAddress(host);
+  return 1;
+}
+
+IPAddress WiFiClass::localIP() {
+  return host::wifiLinkUp() ? script.localIp : IPAddress();
+}
+
+IPAddress WiFiClass::gatewayIP() {
+  return host::wifiLinkUp() ? IPAddress(192, 168, 1, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::subnetMask() {
+  return host::wifiLinkUp() ? IPAddress(255, 255, 255, 0) : IPAddress();
+}
+
+IPAddress WiFiClass::dnsIP(int n) {
+  (void)n;
+  return host::wifiLinkUp() ? IPAddress(192, 168, 1, 1) : IPAddress();
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  static const uint8_t MAC[6] = {0xF4, 0x12, 0xFA, 0xA1, 0xB2, 0xC3};
+  memcpy(mac, MAC, sizeof(MAC));
+  return mac;
+}
+
+WiFiClient::~WiFiClient() {
+  stop();
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  (void)host;
+  (void)port;
+  stop();
+  if (!host::wifiLinkUp()) return 0;
+  open_ = true;
+  linkEpoch_ = linkEpoch;
+  return 1;
+}
+
+uint8_t WiFiClient::connected() {
+  return open_ && linkEpoch_ == linkEpoch && host::wifiLinkUp();
+}
+
+void WiFiClient::stop() {
+  if (!open_) return;
+  open_ = false;
+  host::broker().socketClosed(this);
+}
+
+size_t WiFiClient::write(uint8_t c) {
+  (void)c;
+  return connected() ? 1 : 0;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  (void)port;
+  open_ = host::wifiLinkUp();
+  return open_;
+}
+
+void WiFiUDP::stop() {
+  open_ = false;
+  rx_.clear();
+  cur_.clear();
+  curPos_ = 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  if (!open_ || !host::wifiLinkUp()) return 0;
+  dest_ = ip;
+  destPort_ = port;
+  tx_.clear();
+  sending_ = true;
+  return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return beginPacket(ip, port);
+}
+
+size_t WiFiUDP::write(uint8_t c) {
+  if (!sending_) return 0;
+  tx_.push_back(c);
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t* buf, size_t n) {
+  if (!sending_) return 0;
+  tx_.insert(tx_.end(), buf, buf + n);
+  return n;
+}
+
+int WiFiUDP::endPacket() {
+  if (!sending_) return 0;
+  sending_ = false;
+  if (!host::wifiLinkUp()) return 0;
+  auto it = udpResponders.find(destPort_);
+  std::vector<uint8_t> reply;
+  uint64_t delayUs = 0;
+  if (it != udpResponders.end() && it->second && it->second(dest_, tx_, reply, delayUs)) {
+    rx_.push_back({host::nowUs() + delayUs, reply});
+  }
+  return 1;
+}
+
+int WiFiUDP::parsePacket() {
+  cur_.clear();
+  curPos_ = 0;
+  if (!open_ || rx_.empty() || rx_.front().readyUs > host::nowUs()) return 0;
+  cur_ = rx_.front().data;
+  rx_.pop_front();
+  return (int)cur_.size();
+}
+
+int WiFiUDP::read() {
+  return curPos_ < cur_.size() ? cur_[curPos_++] : -1;
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t n) {
+  size_t avail = cur_.size() - curPos_;
+  if (n > avail) n = avail;
+  memcpy(buf, cur_.data() + curPos_, n);
+  curPos_ += n;
+  return (int)n;
+}
+
+int WiFiUDP::available() {
+  return (int)(cur_.size() - curPos_);
+}
+
+int WiFiUDP::peek() {
+  return curPos_ < cur_.size() ? cur_[curPos_] : -1;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Placeholders for the host build; nothing leaves the process.
+
+const char WIFI_SSID[] = "host-ap";
+const char WIFI_PASS[] = "host-pass";
+
+const char MQTT_BROKER[] = "broker.host";
+const int MQTT_PORT = 1883;
+
+#define USE_MQTT_AUTH 1
+const char MQTT_USER[] = "display";
+const char MQTT_PASS[] = "display-pass";
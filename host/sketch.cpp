@@ -0,0 +1,5 @@
+// The Arduino builder compiles the .ino as C++ with Arduino.h in front;
+// the host build does the same with the fake core.
+#include <Arduino.h>
+
+#include "MQTTDisplay.ino"
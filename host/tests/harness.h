@@ -0,0 +1,96 @@
+#pragma once
+
+// Minimal test support for the host build: checks that count failures
+// instead of aborting, and helpers that step the sketch's loop() on the
+// virtual clock.
+
+#include <stdio.h>
+#include <functional>
+#include <string>
+
+#include "host_hal.h"
+
+void setup();
+void loop();
+
+namespace harness {
+
+inline int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      harness::failures++;                                            \
+    }                                                                 \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                \
+  do {                                                                \
+    long long va = (long long)(a);                                    \
+    long long vb = (long long)(b);                                    \
+    if (va != vb) {                                                   \
+      fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %lld, %s == %lld\n", \
+              __FILE__, __LINE__, #a, va, #b, vb);                    \
+      harness::failures++;                                            \
+    }                                                                 \
+  } while (0)
+
+// Passes in a row that did not move the clock; the scheduler should always
+// sleep before this many.
+const unsigned long SPIN_LIMIT = 10000;
+
+// One loop() pass. Flags a loop that keeps coming back without sleeping.
+inline void step() {
+  static unsigned long still = 0;
+  uint64_t before = host::nowUs();
+  loop();
+  if (host::nowUs() != before) {
+    still = 0;
+  } else if (++still == SPIN_LIMIT) {
+    fprintf(stderr, "loop() ran %lu passes without sleeping\n", SPIN_LIMIT);
+    failures++;
+    host::advanceUs(1000);
+  }
+}
+
+// Steps loop() until ms of virtual time have passed; returns the passes.
+inline unsigned long runFor(unsigned long ms) {
+  uint64_t end = host::nowUs() + (uint64_t)ms * 1000;
+  unsigned long passes = 0;
+  while (host::nowUs() < end) {
+    step();
+    passes++;
+  }
+  return passes;
+}
+
+// Steps loop() until done() holds; false if timeoutMs passed first.
+inline bool runUntil(const std::function<bool()>& done, unsigned long timeoutMs) {
+  uint64_t end = host::nowUs() + (uint64_t)timeoutMs * 1000;
+  while (!done()) {
+    if (host::nowUs() >= end) return false;
+    step();
+  }
+  return true;
+}
+
+// Sends a serial command and returns what the sketch printed for it.
+inline std::string command(const std::string& line) {
+  host::clearSerialOutput();
+  host::serialInput(line + "\n");
+  step();
+  return host::serialOutput();
+}
+
+inline bool contains(const std::string& haystack, const std::string& needle) {
+  return haystack.find(needle) != std::string::npos;
+}
+
+inline int finish(const char* name) {
+  if (failures) fprintf(stderr, "%s: %d check(s) failed\n", name, failures);
+  else printf("%s: ok\n", name);
+  return failures ? 1 : 0;
+}
+
+}  // namespace harness
@@ -0,0 +1,57 @@
+// Boots the sketch against the fakes: setup(), WiFi join, MQTT session,
+// a retained reading on screen, serial status and the sensor journal.
+
+#include "harness.h"
+
+#include "app_state.h"
+#include "sensors.h"
+
+using harness::contains;
+using harness::runFor;
+using harness::runUntil;
+
+int main() {
+  host::Broker& broker = host::broker();
+  // Readings the sensors left on the broker before the display came up.
+  broker.publish(TOPIC_TEMP, "21.5", 1, true);
+  broker.publish(TOPIC_HUM, "48", 1, true);
+
+  setup();
+  CHECK(contains(host::serialOutput(), "Setup done"));
+  CHECK(host::matrix().running);
+  CHECK_EQ(app.connState, CONN_WIFI_WARMUP);
+
+  CHECK(runUntil([] { return app.connState == CONN_OK; }, 60000));
+  CHECK_EQ(host::wifiStats().begins, 1);
+  CHECK_EQ(broker.connects, 1);
+  CHECK(broker.subscribed(TOPIC_TEMP));
+  CHECK(broker.subscribed(TOPIC_HUM));
+  CHECK(broker.retained[TOPIC_STATUS] == MQTT_STATUS_ONLINE);
+
+  runFor(1000);
+  CHECK_EQ(app.sensors[SENSOR_TEMP].value, 2150);
+  CHECK_EQ(app.sensors[SENSOR_HUM].value, 4800);
+  CHECK(host::matrixLitPixels() > 0);
+
+  // A live update replaces the retained one.
+  broker.publish(TOPIC_TEMP, "-3.25");
+  runFor(500);
+  CHECK_EQ(app.sensors[SENSOR_TEMP].value, -325);
+
+  // Idle: the loop sleeps between deadlines instead of spinning.
+  unsigned long passes = runFor(10000);
+  CHECK(passes < 10000 / 5);
+  CHECK(app.framesPushed > 0);
+
+  std::string status = harness::command("status");
+  CHECK(contains(status, "reconnects=0"));
+  CHECK(contains(status, "connect_attempts=1"));
+
+  // Readings reach the journal after PERSIST_MIN_INTERVAL_MS.
+  unsigned long writes = host::eepromWrites();
+  runFor(PERSIST_MIN_INTERVAL_MS + 5000);
+  CHECK(host::eepromWrites() > writes);
+
+  CHECK(contains(harness::command("bogus"), "ERR unknown command"));
+  return harness::finish("test_boot_loop");
+}
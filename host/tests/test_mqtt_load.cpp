@@ -0,0 +1,216 @@
+// MQTT under load: a 10k msg/s flood with malformed payloads, lost acks and
+// a dropped socket (QoS1 redelivery, the will), then a broker restart.
+// Nothing may be lost, redeliveries must be dropped as duplicates, and the
+// UI must keep its tick throughout.
+
+#include "harness.h"
+
+#include "app_state.h"
+#include "sensors.h"
+
+using harness::runUntil;
+
+namespace {
+
+const unsigned long FLOOD_RATE = 10000;  // msgs/s
+const unsigned long FLOOD_COUNT = 20000;
+const uint64_t DELIVERY_COST_US = 25;
+
+struct Flood {
+  uint64_t startUs = 0;
+  unsigned long sent = 0;
+  unsigned long toSensors = 0;
+  int32_t lastValid[SENSOR_COUNT];
+  bool running = false;
+};
+
+Flood flood;
+
+std::string formatValue(int32_t v) {
+  uint32_t mag = v < 0 ? (uint32_t)(-(int64_t)v) : (uint32_t)v;
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%s%lu.%02lu", v < 0 ? "-" : "",
+           (unsigned long)(mag / SENSOR_SCALE), (unsigned long)(mag % SENSOR_SCALE));
+  return buf;
+}
+
+// One of eight shapes: in-range readings plus what a misbehaving publisher
+// can send. Unknown topics are published too; the display never sees them.
+void floodOne(unsigned long i) {
+  uint8_t id = (uint8_t)(i % SENSOR_COUNT);
+  const SensorDef& def = SENSORS[id];
+  std::string payload;
+  switch (i % 8) {
+    case 0:
+    case 1:
+    case 2: {
+      int32_t span = def.maxValue - def.minValue;
+      int32_t v = def.minValue + (int32_t)((i * 7919UL) % (uint32_t)(span + 1));
+      payload = formatValue(v);
+      flood.lastValid[id] = v;
+      break;
+    }
+    case 3: payload = "nan"; break;
+    case 4: payload = ""; break;
+    case 5: payload = "99999999"; break;
+    case 6: payload = "21.5 degrees and some trailing text"; break;
+    default:
+      host::broker().publish("loadtest/unknown", "1");
+      return;
+  }
+  host::broker().publish(def.topic, payload);
+  flood.toSensors++;
+}
+
+// Publishes whatever is due whenever the sketch lets the clock move.
+void floodHook() {
+  if (!flood.running) return;
+  uint64_t due = (host::nowUs() - flood.startUs) * FLOOD_RATE / 1000000 + 1;
+  if (due > FLOOD_COUNT) due = FLOOD_COUNT;
+  while (flood.sent < due) floodOne(flood.sent++);
+  if (flood.sent == FLOOD_COUNT) flood.running = false;
+}
+
+// Worst single loop pass not spent sleeping, and worst gap between two UI
+// ticks (wipes draw on their own clock and are left out).
+struct LoopWatch {
+  uint64_t maxBusyUs = 0;
+  unsigned long maxUiGapMs = 0;
+  unsigned long lastUiMs = 0;
+  unsigned long passes = 0;
+};
+
+LoopWatch watch;
+
+void step() {
+  uint64_t before = host::nowUs();
+  uint64_t slept = host::sleptUs();
+  harness::step();
+  uint64_t busy = (host::nowUs() - before) - (host::sleptUs() - slept);
+  if (busy > watch.maxBusyUs) watch.maxBusyUs = busy;
+  watch.passes++;
+
+  if (app.connState != CONN_OK || app.wipe.active) {
+    watch.lastUiMs = 0;
+  } else if (app.lastUiTickMs != 0 && app.lastUiTickMs != watch.lastUiMs) {
+    if (watch.lastUiMs != 0 && app.lastUiTickMs - watch.lastUiMs > watch.maxUiGapMs) {
+      watch.maxUiGapMs = app.lastUiTickMs - watch.lastUiMs;
+    }
+    watch.lastUiMs = app.lastUiTickMs;
+  }
+}
+
+bool runWatched(const std::function<bool()>& done, unsigned long timeoutMs) {
+  uint64_t end = host::nowUs() + (uint64_t)timeoutMs * 1000;
+  while (!done()) {
+    if (host::nowUs() >= end) return false;
+    step();
+  }
+  return true;
+}
+
+void runFor(unsigned long ms) {
+  uint64_t end = host::nowUs() + (uint64_t)ms * 1000;
+  runWatched([end] { return host::nowUs() >= end; }, ms + 1);
+}
+
+bool connected() {
+  return app.connState == CONN_OK;
+}
+
+}  // namespace
+
+int main() {
+  host::Broker& broker = host::broker();
+  broker.deliveryCostUs = DELIVERY_COST_US;
+  host::setIdleHook(floodHook);
+
+  setup();
+  CHECK(runUntil(connected, 60000));
+  runFor(1000);
+
+  // --- Flood -----------------------------------------------------------------
+  unsigned long deliveredBefore = broker.delivered;
+  unsigned long coalescedBefore = app.connStats.messagesCoalesced;
+  watch = LoopWatch();
+  flood.startUs = host::nowUs();
+  flood.running = true;
+  CHECK(runWatched([&] { return !flood.running && broker.queued() == 0; }, 30000));
+  uint64_t floodUs = host::nowUs() - flood.startUs;
+  runFor(100);
+
+  unsigned long floodDelivered = broker.delivered - deliveredBefore;
+  CHECK_EQ(floodDelivered, flood.toSensors);
+  for (uint8_t id = 0; id < SENSOR_COUNT; id++) {
+    CHECK_EQ(app.sensors[id].value, flood.lastValid[id]);
+  }
+  CHECK(app.connStats.messagesCoalesced > coalescedBefore);
+  CHECK(connected());
+  CHECK_EQ(app.connStats.reconnects, 0);
+  // A burst is cut at the poll budget, so the UI keeps its tick and the
+  // loop stays far from the watchdog.
+  CHECK(watch.maxUiGapMs <= app.uiTickMs + 20);
+  CHECK(watch.maxBusyUs < MQTT_POLL_BUDGET_US + 1000);
+  CHECK(watch.maxBusyUs < (uint64_t)WDT_TIMEOUT_MS * 1000 / 10);
+
+  printf("flood: %lu msgs in %llu ms = %llu msgs/s processed, loop busy max %llu us, "
+         "ui gap max %lu ms, %lu coalesced\n",
+         floodDelivered, (unsigned long long)(floodUs / 1000),
+         (unsigned long long)(floodUs ? (uint64_t)floodDelivered * 1000000 / floodUs : 0),
+         (unsigned long long)watch.maxBusyUs, watch.maxUiGapMs,
+         app.connStats.messagesCoalesced - coalescedBefore);
+
+  // --- Lost acks and a dropped socket ----------------------------------------
+  // The broker never hears the acks for these, so it sends them again with
+  // DUP after the reconnect; the display has applied them already.
+  const unsigned long LOST = 3;
+  broker.loseAcks(LOST);
+  broker.publish(TOPIC_TEMP, "19.25");
+  broker.publish(TOPIC_HUM, "51");
+  broker.publish(TOPIC_TEMP, "19.5");
+  runFor(500);
+  CHECK_EQ(app.sensors[SENSOR_TEMP].value, 1950);
+
+  unsigned long dupsBefore = app.connStats.duplicatesDropped;
+  unsigned long connectsBefore = broker.connects;
+  broker.dropClients();
+  CHECK_EQ(broker.willsSent, 1);
+  CHECK(broker.retained[TOPIC_STATUS] == MQTT_STATUS_OFFLINE);
+  // Published while the display is away: queued in its session.
+  broker.publish(TOPIC_HUM, "55.5");
+
+  CHECK(runWatched([] { return !connected(); }, 5000));
+  CHECK(runWatched(connected, 120000));
+  runFor(1000);
+  CHECK_EQ(broker.connects, connectsBefore + 1);
+  CHECK_EQ(broker.redelivered, LOST);
+  CHECK_EQ(app.connStats.duplicatesDropped - dupsBefore, LOST);
+  CHECK_EQ(app.sensors[SENSOR_TEMP].value, 1950);
+  CHECK_EQ(app.sensors[SENSOR_HUM].value, 5550);
+  CHECK(broker.retained[TOPIC_STATUS] == MQTT_STATUS_ONLINE);
+  CHECK_EQ(app.connStats.reconnects, 1);
+
+  // --- Broker restart --------------------------------------------------------
+  broker.stop();
+  broker.publish(TOPIC_TEMP, "-1.5", 1, true);  // arrives while it restarts
+  CHECK(runWatched([] { return !connected(); }, 5000));
+  runFor(10000);
+  CHECK(broker.refused > 0);
+  broker.start();
+  CHECK(runWatched(connected, 120000));
+  runFor(1000);
+  CHECK_EQ(broker.willsSent, 1);  // a broker going away sends no will
+  CHECK(broker.retained[TOPIC_STATUS] == MQTT_STATUS_ONLINE);
+  CHECK_EQ(app.sensors[SENSOR_TEMP].value, -150);
+  CHECK_EQ(app.connStats.reconnects, 2);
+  CHECK_EQ(broker.connects, connectsBefore + 2);
+  // One online publish per session.
+  CHECK_EQ(broker.countPublished(TOPIC_STATUS, MQTT_STATUS_ONLINE), broker.connects);
+
+  std::string status = harness::command("status");
+  CHECK(harness::contains(status, "reconnects=2"));
+  printf("reconnects: %lu, max %lu ms; %lu duplicates dropped, %lu wills\n",
+         app.connStats.reconnects, app.connStats.maxReconnectMs,
+         app.connStats.duplicatesDropped, broker.willsSent);
+  return harness::finish("test_mqtt_load");
+}
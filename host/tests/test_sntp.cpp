@@ -0,0 +1,163 @@
+// SNTP against a UDP stand-in for an NTP server: first sync, resyncs that
+// track a fast server clock, timeouts, and the DNS lookup of SNTP_SERVER
+// happening only during connection setup, never in a loop pass that stays
+// in CONN_OK.
+
+#include "harness.h"
+
+#include "app_state.h"
+#include "sntp.h"
+
+using harness::runUntil;
+
+namespace {
+
+const uint32_t NTP_UNIX_OFFSET_S = 2208988800UL;
+
+// Server clock: UTC ms at virtual time zero, running SERVER_PPM fast
+// against the board's clock.
+const int64_t SERVER_EPOCH_MS = 1760000000000LL;  // 2025-10-09
+const int64_t SERVER_PPM = 100;
+const uint64_t RTT_US = 40000;
+
+struct NtpServer {
+  bool answer = true;
+  unsigned long requests = 0;
+  unsigned long replies = 0;
+  unsigned long wrongAddress = 0;
+};
+
+NtpServer server;
+
+int64_t serverUtcMs(uint64_t us) {
+  int64_t ms = (int64_t)(us / 1000);
+  return SERVER_EPOCH_MS + ms + ms * SERVER_PPM / 1000000;
+}
+
+void putTimestamp(uint8_t* p, int64_t unixMs) {
+  uint32_t sec = (uint32_t)(unixMs / 1000) + NTP_UNIX_OFFSET_S;
+  uint32_t frac = (uint32_t)(((uint64_t)(unixMs % 1000) << 32) / 1000);
+  for (int i = 0; i < 4; i++) {
+    p[i] = (uint8_t)(sec >> (24 - 8 * i));
+    p[4 + i] = (uint8_t)(frac >> (24 - 8 * i));
+  }
+}
+
+// Mode 4 reply: originate echoes the request's transmit stamp, receive and
+// transmit are the server clock at the midpoint of the round trip.
+bool ntpReply(const IPAddress& dest, const std::vector<uint8_t>& request,
+              std::vector<uint8_t>& reply, uint64_t& delayUs) {
+  server.requests++;
+  if (dest != host::resolvedAddress(SNTP_SERVER)) {
+    server.wrongAddress++;
+    return false;
+  }
+  if (!server.answer || request.size() < 48 || (request[0] & 0x07) != 3) return false;
+  reply.assign(48, 0);
+  reply[0] = 0x24;  // LI 0, version 4, mode 4 (server)
+  reply[1] = 2;     // stratum
+  memcpy(reply.data() + 24, request.data() + 40, 8);
+  int64_t at = serverUtcMs(host::nowUs() + RTT_US / 2);
+  putTimestamp(reply.data() + 32, at);
+  putTimestamp(reply.data() + 40, at);
+  delayUs = RTT_US;
+  server.replies++;
+  return true;
+}
+
+// A pass that starts and ends in CONN_OK must not look anything up.
+unsigned long lookupsInOk = 0;
+
+void step() {
+  bool wasOk = app.connState == CONN_OK;
+  unsigned long lookups = host::wifiStats().dnsLookups;
+  harness::step();
+  if (wasOk && app.connState == CONN_OK && host::wifiStats().dnsLookups != lookups) lookupsInOk++;
+}
+
+bool runWatched(const std::function<bool()>& done, unsigned long timeoutMs) {
+  uint64_t end = host::nowUs() + (uint64_t)timeoutMs * 1000;
+  while (!done()) {
+    if (host::nowUs() >= end) return false;
+    step();
+  }
+  return true;
+}
+
+void runFor(unsigned long ms) {
+  uint64_t end = host::nowUs() + (uint64_t)ms * 1000;
+  runWatched([end] { return host::nowUs() >= end; }, ms + 1);
+}
+
+bool connected() {
+  return app.connState == CONN_OK;
+}
+
+long clockErrorMs() {
+  return (long)(sntpUtcMs(millis()) - serverUtcMs(host::nowUs()));
+}
+
+// Reconnects through the MQTT session only; WiFi stays up.
+void reconnect() {
+  host::broker().dropClients();
+  CHECK(runWatched([] { return !connected(); }, 5000));
+  CHECK(runWatched(connected, 120000));
+}
+
+}  // namespace
+
+int main() {
+  host::setUdpResponder(123, ntpReply);
+  // Long enough that a lookup inside a loop pass would stand out.
+  host::wifi().dnsMs = 500;
+
+  setup();
+  CHECK(runWatched(connected, 60000));
+  CHECK_EQ(host::wifiStats().dnsLookups, 1);
+  CHECK(runWatched(sntpSynced, 10000));
+  CHECK(app.timeValid);
+  CHECK_EQ(server.wrongAddress, 0);
+  CHECK(labs(clockErrorMs()) <= 5);
+
+  // Hourly resyncs pick up the server running fast.
+  runFor(3 * SNTP_RESYNC_MS + 60000);
+  CHECK(sntpStats().syncs >= 4);
+  CHECK(sntpStats().driftPpm > SERVER_PPM / 2);
+  CHECK(sntpStats().driftPpm < SERVER_PPM * 2);
+  CHECK(labs(clockErrorMs()) <= 5);
+  CHECK_EQ(host::wifiStats().dnsLookups, 1);
+
+  // Timeouts: the lookup is only asked for, not done, while CONN_OK lasts.
+  server.answer = false;
+  unsigned long timeouts = sntpStats().timeouts;
+  runFor(SNTP_RESYNC_MS + 4 * (SNTP_TIMEOUT_MS + SNTP_RETRY_MS));
+  CHECK(sntpStats().timeouts >= timeouts + 3);
+  CHECK_EQ(host::wifiStats().dnsLookups, 1);
+
+  // The next connection setup looks the server up again.
+  server.answer = true;
+  reconnect();
+  CHECK_EQ(host::wifiStats().dnsLookups, 2);
+  unsigned long syncs = sntpStats().syncs;
+  CHECK(runWatched([syncs] { return sntpStats().syncs > syncs; }, SNTP_RETRY_MS + 5000));
+
+  // A failed lookup keeps the address that worked.
+  server.answer = false;
+  runFor(SNTP_RESYNC_MS + 4 * (SNTP_TIMEOUT_MS + SNTP_RETRY_MS));
+  server.answer = true;
+  host::wifi().dnsOk = false;
+  reconnect();
+  CHECK_EQ(host::wifiStats().dnsLookups, 3);
+  syncs = sntpStats().syncs;
+  CHECK(runWatched([syncs] { return sntpStats().syncs > syncs; }, SNTP_RETRY_MS + 5000));
+  // The hour without replies left a small offset; it is slewed out.
+  runFor(60000);
+  CHECK(labs(clockErrorMs()) <= 5);
+
+  CHECK_EQ(lookupsInOk, 0);
+  CHECK_EQ(server.wrongAddress, 0);
+  printf("sntp: %lu syncs, %lu timeouts, drift %ld ppm, rtt %lu ms, %lu lookups\n",
+         sntpStats().syncs, sntpStats().timeouts, sntpStats().driftPpm, sntpStats().lastRttMs,
+         host::wifiStats().dnsLookups);
+  return harness::finish("test_sntp");
+}